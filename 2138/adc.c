@@ -13,6 +13,7 @@
 #include <lpc2xxx.h>
 #include <config.h>
 #include "adc.h"
+#include "systime.h"
 
 /******************************************************************************
  * Defines and typedefs
@@ -24,8 +25,9 @@
 /*****************************************************************************
  *
  * Description:
- *    Delay execution by a specified number of milliseconds by using
- *    timer #1. A polled implementation.
+ *    Delay execution by a specified number of milliseconds by polling
+ *    the free-running time base (timer #1 is never stopped or reset,
+ *    see systime.c).
  *
  * Params:
  *    [in] delayInMs - the number of milliseconds to delay.
@@ -34,47 +36,15 @@
 void
 delayMs(tU16 delayInMs)
 {
-  /*
-   * setup timer #1 for delay
-   */
-  T1TCR = 0x02;          // stop and reset timer
-  T1PR  = 0x00;          // set prescaler to zero
-  T1MR0 = delayInMs * (CORE_FREQ / PBSD / 1000);
-  T1IR  = 0xff;          // reset all interrrupt flags
-  T1MCR = 0x04;          // stop timer on match
-  T1TCR = 0x01;          // start timer
+  tU32 start = timeCycles();
+  tU32 length = delayInMs * (CORE_FREQ / PBSD / 1000);
 
   //wait until delay time has elapsed
-  while (T1TCR & 0x01);
+  while ((timeCycles() - start) < length)
+    ;
 }
 
 
-/*****************************************************************************
- *
- * Description:
- *    Start a conversion of one selected analogue input and return
- *    10-bit result.
- *
- * Params:
- *    [in] channel - analogue input channel to convert.
- *
- * Return:
- *    10-bit conversion result
- *
- ****************************************************************************/
-tU16
-getAnalogueInput1(tU8 channel)
-{
-	//start conversion now (for selected channel)
-	AD1CR = (AD1CR & 0xFFFFFF00) | (1 << channel) | (1 << 24);
-	
-	//wait til done
-	while((AD1DR & 0x80000000) == 0);
-
-	//get result and adjust to 10-bit integer
-  return (AD1DR>>6) & 0x3FF;
-}
-
 /*****************************************************************************
  *
  * Description:
@@ -12,6 +12,7 @@
 #define _ADC_H_
 
 #include <general.h>
+#include "fastcode.h"
 
 /******************************************************************************
  * Defines and typedefs
@@ -46,7 +47,7 @@ delayMs(tU16 delayInMs);
  *    10-bit conversion result
  *
  ****************************************************************************/
-tU16 getAnalogueInput1(tU8 channel);
+FASTCODE tU16 getAnalogueInput1(tU8 channel);
 
 /*****************************************************************************
  *
@@ -0,0 +1,46 @@
+/******************************************************************************
+ *
+ * Copyright:
+ *    (C) 2000 - 2005 Embedded Artists AB
+ *
+ * Description:
+ *    ADC conversion run from RAM as ARM code, see fastcode.h. Only
+ *    this file is listed in FAST_CSRCS, the rest of the ADC driver
+ *    (adc.c) stays Thumb code in flash.
+ *
+ *****************************************************************************/
+
+#include <general.h>
+#include <lpc2xxx.h>
+#include "adc.h"
+#include "sampler.h"
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Start a conversion of one selected analogue input and return
+ *    10-bit result. While the accelerometer sampler runs, ACCEL_X and
+ *    ACCEL_Y are not converted and their latest sample is returned.
+ *
+ * Params:
+ *    [in] channel - analogue input channel to convert.
+ *
+ * Return:
+ *    10-bit conversion result
+ *
+ ****************************************************************************/
+FASTCODE tU16
+getAnalogueInput1(tU8 channel)
+{
+	if (samplerIsRunning() && (channel == ACCEL_X || channel == ACCEL_Y))
+		return samplerLast(channel);
+
+	//start conversion now (for selected channel)
+	AD1CR = (AD1CR & 0xFFFFFF00) | (1 << channel) | (1 << 24);
+	
+	//wait til done
+	while((AD1DR & 0x80000000) == 0);
+
+	//get result and adjust to 10-bit integer
+  return (AD1DR>>6) & 0x3FF;
+}
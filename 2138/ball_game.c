@@ -12,20 +12,36 @@
  *****************************************************************************/
 
 #include "pre_emptive_os/api/osapi.h"
+#include "pre_emptive_os/core/_oshal/api/a7hal.h"
 #include "./lcd.h"
 #include "./pca9532.h"
 #include "./adc.h"
+#include "./sprite.h"
+#include "./collision.h"
+#include "./sampler.h"
+#include "./periodic.h"
+#include "./eventflags.h"
+#include "./tilemap.h"
+#include "./prng.h"
+#include "./wave.h"
+#include "./difficulty.h"
+#include "./systime.h"
+#include "./stackmon.h"
 #include "./general.h"
 #include "./ball_game.h"
 #include "startup/framework.h"
 
-#define ACC_X_CTRL_STACK_SIZE 512
-#define ACC_Y_CTRL_STACK_SIZE 512
+#define BALL_CTRL_STACK_SIZE 512
 #define OBSTACLES_CTRL_STACK_SIZE 512
-#define GAME_TIME_STACK_SIZE 128
 
-#define MAX_OBSTACLES 6 
-#define MIN_INTERVAL 30
+
+#define OBSTACLES_START_DELAY_MS 500
+
+#define GAME_WORKERS 2
+#define GAME_WORKER_PRIO 2
+
+// flags of gameEvents
+#define GAME_EVENT_STOP 0x01
 
 #define NOTHING 0x00
 #define UP      0x01
@@ -33,56 +49,114 @@
 #define DOWN    0x04
 #define LEFT    0x08
 
+#define PAUSE_X 29
+#define PAUSE_Y 55
+#define PAUSE_WIDTH 72
+#define PAUSE_HEIGHT 20
 
-typedef struct Ball
+/*
+ * Obstacles kept as a structure of arrays. The slots of live
+ * obstacles are listed densely in active[], so the game loops touch
+ * only those; the other slots are stacked in free[].
+ */
+typedef struct ObstacleStore
 {
-    tU16 xPos;
-    tU16 yPos;
-    tU8 speed;
-    tU8 radius;
-} Ball;
-
-typedef struct Obstacle
+    tS16 xPos[MAX_OBSTACLES];
+    tS16 yPos[MAX_OBSTACLES];
+    tU8 speed[MAX_OBSTACLES];
+    tU8 height[MAX_OBSTACLES];
+    tU8 width[MAX_OBSTACLES];
+    tU8 active[MAX_OBSTACLES];
+    tU8 free[MAX_OBSTACLES];
+    tU8 numActive;
+    tU8 numFree;
+} ObstacleStore;
+
+/*
+ * A persistent game process. It is created once and parks on its
+ * semaphore whenever the game is not running.
+ */
+typedef struct GameWorker
 {
-    tS16 xPos;
-    tS16 yPos;
-    tU8 speed;
-    tU8 height;
-    tU8 width;
-} Obstacle;
-
-static tU8 accXCtrlStack[ACC_X_CTRL_STACK_SIZE];
-static tU8 accYCtrlStack[ACC_Y_CTRL_STACK_SIZE];
+    void (*run)(void);
+    tU8 *stack;
+    tU16 stackSize;
+    const char *name;
+    tCntSem go;
+    tU8 pid;
+} GameWorker;
+
+static tU8 ballCtrlStack[BALL_CTRL_STACK_SIZE];
 static tU8 obstaclesCtrlStack[OBSTACLES_CTRL_STACK_SIZE];
-static tU8 gameTimeStack[GAME_TIME_STACK_SIZE];
 
-static tU8 pidAccXCtrl;
-static tU8 pidAccYCtrl;
-static tU8 pidObstaclesCtrl;
-static tU8 pidGameTime;
 
 static const tU8 pixelsPerDiodRow = (tU8)(LCD_HEIGHT / 8);
 
-static volatile tU16 obstacleDelay = 200;
 static volatile tU8 diodsRow = 0;
-static volatile tBool isInProgress = FALSE;
-static volatile tU32 gameTime = 0;
+static volatile GameState gameState = GAME_IDLE;
+static volatile tU32 gameStartMs = 0;
+static volatile tU32 gameStopMs = 0;
+static volatile tU8 runningWorkers = 0;
+static tCntSem parkedWorkers;
+static tS16 refXValue;
+static tS16 refYValue;
+static GameSnapshot pauseSnapshot;
+static DifficultyLevel level;
+static WaveState wave;
+static WaveRow nextRow;
 static volatile tBool pca9532Present = FALSE;
 
 static Ball ball;
-static Obstacle obstacles[MAX_OBSTACLES];
-
-/*!
- *  @brief    A procedure for delaying the execution
- *            of a code for a given amount of time.
- *  @param delay 
- *            A delay value as an 16-bit unsigned integer.
- */
-static void
-sleep(tU16 delay)
+static ObstacleStore obstacles;
+static PeriodicTask obstaclesTask;
+static EventFlags gameEvents;
+static CollisionMap obstacleMap;
+
+#define K SPRITE_KEY
+#define W WHITE
+#define G (tU8)0xB6u
+static const tU8 ballPixels[] =
 {
-    osSleep(delay / 6);
-}
+    K, W, W, K,
+    W, W, W, G,
+    W, W, W, G,
+    K, G, G, K
+};
+#undef K
+#undef W
+#undef G
+
+static const SpriteImage ballImage = { 4, 4, SPRITE_KEY, ballPixels };
+static Sprite ballSprite;
+static CollisionMask ballMask;
+
+#define _ BLACK
+#define D (tU8)0x49u
+static const tU8 playfieldTiles[2][TILE_BYTES] =
+{
+    {
+        D, _, _, _, _, _, _, _,
+        _, _, _, _, _, _, _, _,
+        _, _, _, _, _, _, _, _,
+        _, _, _, _, _, _, _, _,
+        _, _, _, _, _, _, _, _,
+        _, _, _, _, _, _, _, _,
+        _, _, _, _, _, _, _, _,
+        _, _, _, _, _, _, _, _
+    },
+    {
+        _, _, _, _, _, _, _, _,
+        _, _, _, _, _, _, _, _,
+        _, _, _, _, _, _, _, _,
+        _, _, _, D, D, _, _, _,
+        _, _, _, D, D, _, _, _,
+        _, _, _, _, _, _, _, _,
+        _, _, _, _, _, _, _, _,
+        _, _, _, _, _, _, _, _
+    }
+};
+#undef _
+#undef D
 
 /*!
  *  @brief    A function for clamping a value between
@@ -104,23 +178,6 @@ clamp(tS16 val, tS16 min, tS16 max)
     return val;
 }
 
-/*!
- *  @brief    A function for generating a pseudo-random
- *            16-bit unsigned integer value.
- *  @param minInc 
- *            Min value (inclusive)
- *  @param maxInc
- *            Max value (inclusive)
- *  @returns  a pseudo-random 16-bit unsigned integer
- *            ranging from minInc to maxInc
- */
-static tU16
-random(tU16 minInc, tU16 maxInc)
-{
-    if (maxInc < minInc) return 0;
-    return rand() % (maxInc - minInc + 1) + minInc;
-}
-
 /*!
  *  @brief    A function for calculating ball movement
  *            strength.
@@ -151,6 +208,29 @@ calculateDelay(tU16 strength)
     return 136 - 16 * strength;     // linear
 }
 
+/*!
+ *  @brief    A function for reading the in-game time,
+ *            measured on the wall clock from the start
+ *            of the game to now or to its end.
+ *  @returns  in-game time in milliseconds
+ */
+static tU32
+getGameTimeMs(void)
+{
+    tU32 endMs = gameState == GAME_RUNNING ? timeNowMs() : gameStopMs;
+    return endMs - gameStartMs;
+}
+
+/*!
+ *  @brief    A function for reading the in-game time.
+ *  @returns  in-game time in hundredths of a second
+ */
+static tU32
+getGameTime(void)
+{
+    return getGameTimeMs() / 10;
+}
+
 /*!
  *  @brief    A function for reading player's score.
  *  @returns  player's score as an 32-bit unsigned integer
@@ -158,140 +238,197 @@ calculateDelay(tU16 strength)
 tU32
 getScore(void)
 {
+    tU32 gameTime = getGameTime();
     return gameTime - (gameTime % 10);
 }
 
 /*!
- *  @brief    A function resposible for checking
- *            if the collision between the ball and
- *            given obstacle has occured.
- *  @param obstacle
- *            A pointer to the obstacle object for which
- *            the collision check shall happen.
- *  @returns  true if collisions occured, false if it did not
+ *  @brief    A procedure for removing all the obstacles.
  */
-static tBool
-isCollision(Obstacle *obstacle)
+static void
+resetObstacles(void)
 {
-    tU8 ballRadius = ball.radius;
+    tU8 i;
 
-    tU16 ballYPos = ball.yPos;
-    tU16 obstacleYPos = obstacle->yPos;
-    tU8 obstacleHeight = obstacle->height;
-    if (ballYPos > obstacleYPos + obstacleHeight ||
-        ballYPos + ballRadius < obstacleYPos) return FALSE;
+    obstacles.numActive = 0;
+    obstacles.numFree = MAX_OBSTACLES;
+    for (i = 0; i < MAX_OBSTACLES; i++)
+        obstacles.free[i] = MAX_OBSTACLES - 1 - i;
+    collisionClear(&obstacleMap);
+}
 
-    tU16 ballXPos = ball.xPos;
-    tU16 obstacleXPos = obstacle->xPos;
-    tU8 obstacleWidth = obstacle->width;
-    if (ballXPos > obstacleXPos + obstacleWidth ||
-        ballXPos + ballRadius < obstacleXPos) return FALSE;
+/*!
+ *  @brief    A function for taking a free obstacle slot,
+ *            appending it to the active list and marking
+ *            its area in the collision map.
+ *  @param xPos
+ *            Left edge of the obstacle.
+ *  @param yPos
+ *            Top edge of the obstacle.
+ *  @param width
+ *            Width of the obstacle.
+ *  @param height
+ *            Height of the obstacle.
+ *  @param speed
+ *            Pixels per obstacle move.
+ *  @returns  the slot of the new obstacle
+ */
+static tU8
+spawnObstacle(tS16 xPos, tS16 yPos, tU8 width, tU8 height, tU8 speed)
+{
+    tU8 slot = obstacles.free[--obstacles.numFree];
+    obstacles.active[obstacles.numActive++] = slot;
+
+    obstacles.xPos[slot] = xPos;
+    obstacles.yPos[slot] = yPos;
+    obstacles.width[slot] = width;
+    obstacles.height[slot] = height;
+    obstacles.speed[slot] = speed;
+    collisionFill(&obstacleMap, xPos, yPos, width, height, TRUE);
+    return slot;
+}
 
-    return TRUE;
+/*!
+ *  @brief    A procedure for returning an obstacle to
+ *            the free list. The last active obstacle takes
+ *            its place in the active list.
+ *  @param index
+ *            Position of the obstacle in the active list.
+ */
+static void
+retireObstacle(tU8 index)
+{
+    tU8 slot = obstacles.active[index];
+    obstacles.active[index] = obstacles.active[--obstacles.numActive];
+    obstacles.free[obstacles.numFree++] = slot;
 }
 
 /*!
- *  @brief    A procedure used to randomize the
- *            properties of the new obstacle and move
- *            it on top of the game-area
- *  @param obstacle
- *            A pointer to the obstacle object
- *            to be randomized.
+ *  @brief    A procedure for updating the difficulty
+ *            from the in-game time, see difficulty.c.
  */
 static void
-randomizeObstacle(Obstacle *obstacle)
+updateDifficulty(void)
 {
-    tU8 newWidth = (tU8)random(20, 60);
-    tU8 newHeight = (tU8)random(1, 5);
-    tU8 newSpeed = (tU8)random(1, 5);
-    tU16 newXPos = random(0, LCD_WIDTH - newWidth);
-    tU16 newYPos = 0;
+    difficultyAt(getGameTimeMs(), &level);
+    ball.speed = level.ballSpeed;
+}
 
-    obstacle->width = newWidth;
-    obstacle->height = newHeight;
-    obstacle->speed = newSpeed;
-    obstacle->xPos = newXPos;
-    obstacle->yPos = newYPos;
+/*!
+ *  @brief    A function limiting the speed of a new row
+ *            so that it cannot catch up with any live
+ *            obstacle before that one leaves the screen.
+ *            Slow obstacles far down the screen leave
+ *            before a faster row reaches them, so only
+ *            those near the spawn zone lower the speed.
+ *  @param speed
+ *            Speed of the new row given by the wave.
+ *  @param height
+ *            Height of the new row.
+ *  @returns  the speed, lowered if needed
+ */
+static tU8
+capRowSpeed(tU8 speed, tU8 height)
+{
+    tU8 i;
+
+    for (i = 0; i < obstacles.numActive; i++)
+    {
+        tU8 slot = obstacles.active[i];
+        tU8 rowSpeed = obstacles.speed[slot];
+        tS16 gap = obstacles.yPos[slot] - height;
+        tS16 left = LCD_HEIGHT - obstacles.yPos[slot];
+        tU16 limit;
+
+        if (speed <= rowSpeed || left <= 0) continue;
+        if (gap < 0) gap = 0;
+        // the gap closes by speed - rowSpeed per step and the
+        // obstacle leaves the screen in left / rowSpeed steps
+        limit = rowSpeed + (tU16)((tU32)gap * rowSpeed / left);
+        if (speed > limit) speed = (tU8)limit;
+    }
+    return speed;
 }
 
 /*!
- *  @brief    A procedure used to create an obstacle,
- *            when the are too few. Our application uses
- *            object-pooling method to reduce costs of
- *            instantiating new objects, so it looks for
- *            any out-of-in-game-area obstacle and if found
- *            it randomizes it's properties and moves it
- *            to the top.
+ *  @brief    A procedure used to create the next row
+ *            of obstacles given by the wave scheduler, once
+ *            the previous row has moved far enough from the
+ *            top and enough slots are free. The row is
+ *            slowed down if it would close a gap, see
+ *            capRowSpeed.
  */
 static void
 fillObstacles(void)
 {
-    tU16 minY = LCD_HEIGHT;
-    Obstacle *newObstacle = NULL;
+    tS16 minY = LCD_HEIGHT;
+    tU8 speed = nextRow.speed;
     tU8 i;
-    for (i = 0; i < MAX_OBSTACLES; i++)
+
+    if (obstacles.numFree < nextRow.numBlocks) return;
+    for (i = 0; i < obstacles.numActive; i++)
     {
-        Obstacle *obstacle = &obstacles[i];
-        tU16 yPos = obstacle->yPos;
-        if (yPos < LCD_HEIGHT)
-        {
-            if (yPos < minY) minY = yPos;
-            continue;
-        }
-        newObstacle = obstacle;
+        tS16 yPos = obstacles.yPos[obstacles.active[i]];
+        if (yPos < minY) minY = yPos;
     }
-    if (minY < MIN_INTERVAL || newObstacle == NULL) return;
+    if (minY < nextRow.spacing) return;
 
-    randomizeObstacle(newObstacle);
+    speed = capRowSpeed(speed, nextRow.height);
+    for (i = 0; i < nextRow.numBlocks; i++)
+    {
+        spawnObstacle(nextRow.blocks[i].x, 0, nextRow.blocks[i].width,
+                      nextRow.height, speed);
+    }
+
+    waveNextRow(&wave, &level, &nextRow);
 }
 
 /*!
  *  @brief    A function checking if any ball-obstacle
- *            collision occured.
+ *            collision occured. The opaque pixels of the
+ *            ball are tested against the obstacle map, so
+ *            the transparent corners of the sprite do not
+ *            collide.
  *  @returns  true if such at least one occured,
  *            false if none
  */
 static tBool
 isAnyCollision(void)
 {
-    tU8 i;
-    for (i = 0; i < MAX_OBSTACLES; i++)
-    {
-        Obstacle *obstacle = &obstacles[i];
-        if (isCollision(obstacle)) return TRUE;
-    }
-    return FALSE;
+    return collisionTest(&obstacleMap, &ballMask, ball.xPos, ball.yPos);
 }
 
 /*!
- *  @brief    A procedure for drawing the ball
- *            with the specified color.
+ *  @brief    A procedure for drawing over all the
+ *            active obstacles with the specified color.
  *  @param color
  *            A unsigned value 0-255 specifying a color.
  */
 static void
-overdrawBall(tU8 color)
+overdrawObstacles(tU8 color)
 {
-    lcdRect(ball.xPos, ball.yPos, ball.radius, ball.radius, color);
+    tU8 i;
+    for (i = 0; i < obstacles.numActive; i++)
+    {
+        tU8 slot = obstacles.active[i];
+        lcdRect(obstacles.xPos[slot], obstacles.yPos[slot],
+                obstacles.width[slot], obstacles.height[slot], color);
+    }
 }
 
 /*!
- *  @brief    A procedure for drawing over all the
- *            obstacles, that are in the in-game area, 
- *            with the specified color.
- *  @param color
- *            A unsigned value 0-255 specifying a color.
+ *  @brief    A procedure for marking the background
+ *            under all the active obstacles as dirty.
  */
 static void
-overdrawObstacles(tU8 color)
+markObstaclesDirty(void)
 {
     tU8 i;
-    for (i = 0; i < MAX_OBSTACLES; i++)
+    for (i = 0; i < obstacles.numActive; i++)
     {
-        Obstacle *obstacle = &obstacles[i];
-        if (obstacle->yPos > LCD_HEIGHT) continue;
-
-        lcdRect(obstacle->xPos, obstacle->yPos, obstacle->width, obstacle->height, color);
+        tU8 slot = obstacles.active[i];
+        tileMapMarkDirty(obstacles.xPos[slot], obstacles.yPos[slot],
+                         obstacles.width[slot], obstacles.height[slot]);
     }
 }
 
@@ -334,80 +471,86 @@ updateDiods(void)
 static void
 moveBall(tU8 dir)
 {
-    tBool moved = TRUE;
     switch (dir)
     {
     case UP:
-        overdrawBall(BLACK);
         ball.yPos = clamp(ball.yPos - ball.speed, 0, LCD_HEIGHT - ball.radius - 1);
         break;
     case DOWN:
-        overdrawBall(BLACK);
         ball.yPos = clamp(ball.yPos + ball.speed, 0, LCD_HEIGHT - ball.radius - 1);
         break;
     case LEFT:
-        overdrawBall(BLACK);
         ball.xPos = clamp(ball.xPos - ball.speed, 0, LCD_WIDTH - ball.radius - 1);
         break;
     case RIGHT:
-        overdrawBall(BLACK);
         ball.xPos = clamp(ball.xPos + ball.speed, 0, LCD_WIDTH - ball.radius - 1);
         break;
     default:
-        moved = FALSE;
-        break;
+        return;
     }
 
-    if (moved == FALSE) return;
-
-    overdrawBall(WHITE);
+    spriteMove(&ballSprite, ball.xPos, ball.yPos);
     detectCollisions();
 }
 
 /*!
  *  @brief    A procedure for actually moving all
- *            the obstacles, that are in the game area
- *            and detecting possible collisions afterwards.
+ *            the active obstacles and detecting possible
+ *            collisions afterwards. Obstacles that left
+ *            the game area are retired. Only the background
+ *            tiles uncovered by the move are redrawn.
  */
 static void
 moveObstacles(void)
 {
-    overdrawObstacles(BLACK);
-    tU8 i;
-    for (i = 0; i < MAX_OBSTACLES; i++)
+    tU8 i = 0;
+    while (i < obstacles.numActive)
     {
-        Obstacle *obstacle = &obstacles[i];
-        if (obstacle->yPos > LCD_HEIGHT) continue;
-
-        obstacle->yPos += obstacle->speed;
+        tU8 slot = obstacles.active[i];
+        tU8 speed = obstacles.speed[slot];
+        tU8 height = obstacles.height[slot];
+        tU8 uncovered = speed < height ? speed : height;
+        tS16 xPos = obstacles.xPos[slot];
+        tS16 yPos = obstacles.yPos[slot];
+        tU8 width = obstacles.width[slot];
+
+        // only the rows the obstacle leaves and enters change in the map
+        tileMapMarkDirty(xPos, yPos, width, uncovered);
+        collisionFill(&obstacleMap, xPos, yPos, width, uncovered, FALSE);
+        collisionFill(&obstacleMap, xPos, yPos + height + speed - uncovered,
+                      width, uncovered, TRUE);
+        obstacles.yPos[slot] += speed;
+
+        // the last active obstacle moves to i, so check it next
+        if (obstacles.yPos[slot] >= LCD_HEIGHT) retireObstacle(i);
+        else i++;
     }
+
+    tBool ballCovered = tileMapIsDirty(ball.xPos, ball.yPos, ball.radius, ball.radius);
+    tileMapFlush();
     overdrawObstacles(WHITE);
+    if (ballCovered) spriteRedraw(&ballSprite);
     detectCollisions();
 }
 
 /*!
- *  @brief    A procedure for moving the ball in
- *            a certain direction, with a certain strength,
- *            optionally updating the diods and finally
- *            waiting some amount of time.
+ *  @brief    A function for moving the ball in
+ *            a certain direction, with a certain strength.
  *  @param absoluteValue 
  *            Absolute value of the move, is a base for
  *            calculating the strength of move and a delay.
  *  @param dir
  *            Direction in which the ball will move.
- *  @param update
- *            tBool indicating if diods update is neccessary.
+ *  @returns  delay in milliseconds until the next
+ *            move along the same axis is due
  */
-static void
-moveBallAndWait(tU16 absoluteValue, tU8 dir, tBool update)
+static tU16
+moveBallStep(tU16 absoluteValue, tU8 dir)
 {
     tU16 strength = calculateStrength(absoluteValue);
-    tU16 delay = calculateDelay(strength);
 
     if (strength > 0) moveBall(dir);
-    if (update) updateDiods();
-
-    sleep(delay);
+    return calculateDelay(strength);
 }
 
 /*!
@@ -432,107 +575,345 @@ diodsShowOff(tU16 delay)
         tU8 rightPin = 15 - leftPin;
         setPca9532Pin(leftPin, 0);
         setPca9532Pin(rightPin, 0);
-        sleep(delay);
+        timeSleepMs(delay);
         setPca9532Pin(leftPin, 1);
         setPca9532Pin(rightPin, 1);
     }
 }
 
 /*!
- *  @brief    A procedure responsible for measuring
- *            user's in-game time and periodically increasing
- *            the difficulty level by speeding-up the obstacles.
- *            Designed to be a separate process.
- *  @param arg
- *            Not used in this application
+ *  @brief    A function for sleeping until a deadline
+ *            or until the game stops running, whichever
+ *            comes first, so a pause or a game over
+ *            parks the worker at once.
+ *  @param deadlineMs
+ *            Absolute time in milliseconds (see timeNowMs).
+ *  @returns  true if the deadline has passed with the
+ *            game still running
+ */
+static tBool
+sleepUntilOrStop(tU32 deadlineMs)
+{
+    tS32 remaining;
+
+    while ((remaining = (tS32)(deadlineMs - timeNowMs())) > 0)
+    {
+        tU32 ticks = (tU32)remaining / timeTickMs();
+        if (eventFlagsWait(&gameEvents, GAME_EVENT_STOP, EVENT_FLAGS_ANY, ticks > 0 ? ticks : 1) != 0)
+            return FALSE;
+    }
+    return gameState == GAME_RUNNING;
+}
+
+/*!
+ *  @brief    A procedure responsible for reading
+ *            both axes of accelerometer and moving the
+ *            ball accordingly to the input values.
+ *            Each axis keeps its own deadline, so the
+ *            pace of the two is independent.
+ *            Runs in a game worker while the game is running.
  */
 static void
-gameTimeProc(void *arg)
+ballCtrlRun(void)
 {
-    tU8 hoodlum = 0;
-    while (isInProgress)
+    tU32 xDeadline = timeNowMs();
+    tU32 yDeadline = xDeadline;
+    while (gameState == GAME_RUNNING)
     {
-        gameTime++;
-        if (hoodlum++ >= 50)
+        tS32 untilY = (tS32)(yDeadline - xDeadline);
+
+        if (sleepUntilOrStop(untilY < 0 ? yDeadline : xDeadline) == FALSE) break;
+
+        if (untilY >= 0)
         {
-            hoodlum = 0;
-            obstacleDelay -= (obstacleDelay / 20);
+            tS16 value = refXValue - samplerRead(ACCEL_X);
+            xDeadline += moveBallStep(abs(value), value > 0 ? UP : DOWN);
+        }
+        if (untilY <= 0)
+        {
+            tS16 value = refYValue - samplerRead(ACCEL_Y);
+            yDeadline += moveBallStep(abs(value), value > 0 ? RIGHT : LEFT);
+            updateDiods();
         }
-        sleep(10);
     }
-
-    osDeleteProcess();
 }
 
 /*!
- *  @brief    A procedure responsible for reading
- *            the X-axis of accelerometer and moving the
- *            ball accordingly to the input value.
- *            Designed to be a separate process.
- *  @param arg
- *            Not used in this application
+ *  @brief    A procedure responsible for obstacles
+ *            movement, respawning and the difficulty,
+ *            which follows the in-game time. Steps are
+ *            released by a periodic task at the obstacle
+ *            period of the current difficulty level.
+ *            Runs in a game worker while the game is running.
  */
 static void
-accXCtrlProc(void *arg)
+obstaclesCtrlRun(void)
 {
-    tS16 refXValue = getAnalogueInput1(ACCEL_X);
-    while (isInProgress)
+    tU32 firstMove = gameStartMs + OBSTACLES_START_DELAY_MS;
+
+    // a fresh game gives the player a moment before the first obstacle
+    if (sleepUntilOrStop(firstMove) == FALSE) return;
+
+    updateDifficulty();
+    if (periodicStart(&obstaclesTask, "obstacles", level.obstacleDelayMs) == FALSE) return;
+
+    while (gameState == GAME_RUNNING)
     {
-        tS16 value = refXValue - getAnalogueInput1(ACCEL_X);
-        tU16 absoluteValue = abs(value);
+        updateDifficulty();
+        fillObstacles();
+        moveObstacles();
+        periodicWait(&obstaclesTask);
+        periodicSetPeriod(&obstaclesTask, level.obstacleDelayMs);
+    }
+    periodicStop(&obstaclesTask);
+}
+
+static GameWorker workers[GAME_WORKERS] =
+{
+    { ballCtrlRun, ballCtrlStack, BALL_CTRL_STACK_SIZE, "ball" },
+    { obstaclesCtrlRun, obstaclesCtrlStack, OBSTACLES_CTRL_STACK_SIZE, "obstacles" }
+};
+
+/*!
+ *  @brief    A function for atomically moving the game
+ *            from one of the given states to a new one.
+ *  @param from
+ *            Bit mask of the states the move is allowed
+ *            from, see GAME_STATE_BIT.
+ *  @param to
+ *            The new state.
+ *  @param nowMs
+ *            Current time. When the game leaves the
+ *            running state the in-game clock is stopped
+ *            at this time, together with the state, so
+ *            a worker woken by the change never sees the
+ *            new state with the old stop time.
+ *  @returns  true if the state has been changed
+ */
+static tBool
+changeState(tU8 from, GameState to, tU32 nowMs)
+{
+    volatile tSR localSR;
+    tBool changed = FALSE;
 
-        if (value > 0) moveBallAndWait(absoluteValue, UP, FALSE);
-        else moveBallAndWait(absoluteValue, DOWN, FALSE);
+    m_os_dis_int();
+    if (GAME_STATE_BIT(gameState) & from)
+    {
+        if (gameState == GAME_RUNNING) gameStopMs = nowMs;
+        gameState = to;
+        changed = TRUE;
     }
+    m_os_ena_int();
 
-    osDeleteProcess();
+    if (changed && to != GAME_RUNNING) eventFlagsSet(&gameEvents, GAME_EVENT_STOP);
+    return changed;
 }
 
 /*!
- *  @brief    A procedure responsible for reading
- *            the Y-axis of accelerometer and moving the
- *            ball accordingly to the input value.
- *            Designed to be a separate process.
- *  @param arg
- *            Not used in this application
+ *  @brief    A procedure for waiting until all the
+ *            game workers are parked.
  */
-void
-accYCtrlProc(void *arg)
+static void
+waitWorkersParked(void)
+{
+    tU8 error;
+    tU8 i;
+
+    for (i = 0; i < GAME_WORKERS; i++)
+        osSemTake(&parkedWorkers, 0, &error);
+}
+
+/*!
+ *  @brief    A procedure for releasing the game workers,
+ *            which must all be parked, to run the game.
+ */
+static void
+releaseWorkers(void)
 {
-    tS16 refYValue = getAnalogueInput1(ACCEL_Y);
-    while (isInProgress)
+    tU8 error;
+    tU8 i;
+
+    runningWorkers = GAME_WORKERS;
+    eventFlagsClear(&gameEvents, GAME_EVENT_STOP);
+    gameState = GAME_RUNNING;
+    for (i = 0; i < GAME_WORKERS; i++)
+        osSemGive(&workers[i].go, &error);
+}
+
+/*!
+ *  @brief    A procedure for giving the parked workers
+ *            back after waitWorkersParked.
+ */
+static void
+returnWorkersParked(void)
+{
+    tU8 error;
+    tU8 i;
+
+    for (i = 0; i < GAME_WORKERS; i++)
+        osSemGive(&parkedWorkers, &error);
+}
+
+static void displayScoreWindow(void);
+
+/*!
+ *  @brief    A procedure for taking a snapshot of the
+ *            game state. The workers must be parked.
+ *  @param snapshot
+ *            A pointer to the snapshot to fill.
+ */
+static void
+takeSnapshot(GameSnapshot *snapshot)
+{
+    tU8 i;
+
+    snapshot->version = GAME_SNAPSHOT_VERSION;
+    snapshot->gameTimeMs = gameStopMs - gameStartMs;
+    snapshot->prngState = prngState;
+    snapshot->ball = ball;
+    snapshot->wave = wave;
+    snapshot->nextRow = nextRow;
+    snapshot->numObstacles = obstacles.numActive;
+    for (i = 0; i < obstacles.numActive; i++)
     {
-        tS16 value = refYValue - getAnalogueInput1(ACCEL_Y);
-        tU16 absoluteValue = abs(value);
+        tU8 slot = obstacles.active[i];
+        Obstacle *obstacle = &snapshot->obstacles[i];
+
+        obstacle->xPos = obstacles.xPos[slot];
+        obstacle->yPos = obstacles.yPos[slot];
+        obstacle->speed = obstacles.speed[slot];
+        obstacle->height = obstacles.height[slot];
+        obstacle->width = obstacles.width[slot];
+    }
+}
+
+/*!
+ *  @brief    A procedure for drawing the objects of
+ *            the game over the background: tiles marked
+ *            as dirty are flushed, then the obstacles
+ *            and the ball are drawn on top of them.
+ */
+static void
+redrawObjects(void)
+{
+    tileMapFlush();
+    overdrawObstacles(WHITE);
+    spriteRedraw(&ballSprite);
+}
+
+/*!
+ *  @brief    A procedure for restoring the game state
+ *            from a snapshot. Only the areas of the objects
+ *            that moved and of the pause window are redrawn.
+ *            The workers must be parked.
+ *  @param snapshot
+ *            A pointer to the snapshot to restore.
+ */
+static void
+restoreSnapshot(const GameSnapshot *snapshot)
+{
+    tU8 i;
 
-        if (value > 0) moveBallAndWait(absoluteValue, RIGHT, TRUE);
-        else moveBallAndWait(absoluteValue, LEFT, TRUE);
-        updateDiods();
+    tileMapMarkDirty(PAUSE_X, PAUSE_Y, PAUSE_WIDTH, PAUSE_HEIGHT);
+    tileMapMarkDirty(ball.xPos, ball.yPos, ball.radius, ball.radius);
+    markObstaclesDirty();
+
+    gameStopMs = timeNowMs();
+    gameStartMs = gameStopMs - snapshot->gameTimeMs;
+    difficultyAt(snapshot->gameTimeMs, &level);
+    prngState = snapshot->prngState;
+    ball = snapshot->ball;
+    wave = snapshot->wave;
+    nextRow = snapshot->nextRow;
+    resetObstacles();
+    for (i = 0; i < snapshot->numObstacles && i < MAX_OBSTACLES; i++)
+    {
+        const Obstacle *obstacle = &snapshot->obstacles[i];
+        spawnObstacle(obstacle->xPos, obstacle->yPos, obstacle->width,
+                      obstacle->height, obstacle->speed);
     }
 
-    osDeleteProcess();
+    ballSprite.xPos = ball.xPos;
+    ballSprite.yPos = ball.yPos;
+    redrawObjects();
 }
 
 /*!
- *  @brief    A procedure responsible for obstacles
- *            movement, respawning and speed.
- *            Designed to be a separate process. 
+ *  @brief    A procedure for showing the pause window.
+ */
+static void
+displayPauseWindow(void)
+{
+    lcdRect(PAUSE_X, PAUSE_Y, PAUSE_WIDTH, PAUSE_HEIGHT, WHITE);
+    lcdGotoxy(PAUSE_X + 12, PAUSE_Y + 3);
+    lcdPuts("PAUSED");
+}
+
+/*!
+ *  @brief    A procedure for showing the end of the
+ *            game, once no worker draws any more.
+ */
+static void
+showGameOver(void)
+{
+    diodsShowOff(40);
+    displayScoreWindow();
+}
+
+/*!
+ *  @brief    A procedure of the persistent game processes.
+ *            The worker waits on its semaphore, runs its part
+ *            of the game until the game leaves the running
+ *            state and parks again. The last worker to leave
+ *            a finished game draws the game over screen.
  *  @param arg
- *            Not used in this application
+ *            A pointer to the GameWorker.
  */
-void
-obstaclesCtrlProc(void *arg)
+static void
+gameWorkerProc(void *arg)
 {
-    sleep(500);
+    GameWorker *worker = (GameWorker *)arg;
+    tU8 error;
 
-    while (isInProgress)
+    for (;;)
     {
-        fillObstacles();
-        moveObstacles();
-        sleep(obstacleDelay);
+        volatile tSR localSR;
+        tBool last;
+
+        osSemTake(&worker->go, 0, &error);
+        worker->run();
+
+        m_os_dis_int();
+        last = --runningWorkers == 0;
+        m_os_ena_int();
+
+        if (last && gameState == GAME_OVER) showGameOver();
+        if (last && gameState == GAME_PAUSED)
+        {
+            takeSnapshot(&pauseSnapshot);
+            displayPauseWindow();
+        }
+        osSemGive(&parkedWorkers, &error);
     }
+}
 
-    osDeleteProcess();
+/*!
+ *  @brief    Background of the ball sprite: obstacles
+ *            over the tile map. Pixel-exact collisions
+ *            let the transparent corners of the ball
+ *            overlap an obstacle, which must then be
+ *            repainted too.
+ *  @param x
+ *            Screen x-coordinate of the pixel.
+ *  @param y
+ *            Screen y-coordinate of the pixel.
+ *  @returns  colour of the background pixel
+ */
+static tU8
+gameBackgroundPixel(tU8 x, tU8 y)
+{
+    if (collisionIsSet(&obstacleMap, x, y)) return WHITE;
+    return tileMapPixel(x, y);
 }
 
 /*!
@@ -543,26 +924,35 @@ void
 initScene(void)
 {
     lcdColor(BLACK, WHITE);
-    lcdClrscr();
 
-    gameTime = 0;
-    obstacleDelay = 200;
+    tU8 row;
+    tU8 col;
+    tileMapInit(&playfieldTiles[0][0]);
+    for (row = 0; row < TILEMAP_ROWS; row++)
+    {
+        for (col = 0; col < TILEMAP_COLS; col++)
+            tileMapSet(col, row, (row + col) & 1);
+    }
+    lcdClrscr(); // the tiles cover 128x128 of the 130x130 panel
+    tileMapDrawAll();
+    spriteSetBackground(gameBackgroundPixel);
+
+    difficultyAt(0, &level);
 
     tU16 heightMiddle = LCD_HEIGHT / 2;
     tU16 widthMiddle = LCD_HEIGHT / 2;
     ball.xPos = widthMiddle;
     ball.yPos = heightMiddle;
-    ball.speed = 5;
-    ball.radius = 4;
-
+    ball.speed = level.ballSpeed;
+    ball.radius = ballImage.width;
 
-    tU8 i;
-    for (i = 0; i < MAX_OBSTACLES; i++)
-    {
-        obstacles[i].yPos = LCD_HEIGHT + 1;
-    }
+    resetObstacles();
+    waveReset(&wave);
+    waveNextRow(&wave, &level, &nextRow);
 
-    overdrawBall(WHITE);
+    spriteInit(&ballSprite, &ballImage);
+    collisionMaskInit(&ballMask, &ballImage);
+    spriteShow(&ballSprite, ball.xPos, ball.yPos);
 }
 
 /*!
@@ -594,46 +984,172 @@ displayScoreWindow(void)
 
 
 /*!
- *  @brief    A procedure for starting a new game,
- *            it creates all the processes needed for 
- *            movement controll, obstacles movement and 
- *            in-game-timer.
+ *  @brief    A procedure for creating the persistent
+ *            game processes. Must be called once, before
+ *            the first game is started.
+ */
+void
+initGame(void)
+{
+    tU8 error;
+    tU8 i;
+
+    osSemInit(&parkedWorkers, GAME_WORKERS);
+    eventFlagsInit(&gameEvents);
+    for (i = 0; i < GAME_WORKERS; i++)
+    {
+        GameWorker *worker = &workers[i];
+        osSemInit(&worker->go, 0);
+        osCreateProcess(gameWorkerProc, worker->stack, worker->stackSize,
+                        &worker->pid, GAME_WORKER_PRIO, worker, &error);
+        osStartProcess(worker->pid, &error);
+        stackMonAddProcess(worker->name, worker->pid, worker->stack, worker->stackSize);
+    }
+}
+
+/*!
+ *  @brief    A function for reading the game state.
+ *  @returns  current state of the game
+ */
+GameState
+getGameState(void)
+{
+    return gameState;
+}
+
+/*!
+ *  @brief    A function for lending the obstacle map
+ *            as scratch memory while no game is in
+ *            progress. Its contents are then not needed,
+ *            the next game clears it. The caller must not
+ *            start a game while using it.
+ *  @returns  a pointer to the map, or NULL if a game
+ *            is in progress
+ */
+CollisionMap *
+gameBorrowObstacleMap(void)
+{
+    if (gameState != GAME_IDLE && gameState != GAME_OVER) return NULL;
+    return &obstacleMap;
+}
+
+/*!
+ *  @brief    A procedure for starting a new game.
+ *            It waits for the workers of the previous
+ *            game to park, counts down and releases them.
  */
 void
 startGame(void)
 {
-    if (isInProgress) return;
-    isInProgress = TRUE;
+    if (changeState(GAME_STATE_BIT(GAME_IDLE) | GAME_STATE_BIT(GAME_OVER), GAME_COUNTDOWN, timeNowMs()) == FALSE)
+        return;
+
+    waitWorkersParked();
 
-    tU8 error;
     pca9532Present = pca9532Init();
     initScene();
+    // drop the samples taken while idle, calibrate over the countdown
+    samplerRead(ACCEL_X);
+    samplerRead(ACCEL_Y);
     diodsShowOff(40);
+    refXValue = samplerRead(ACCEL_X);
+    refYValue = samplerRead(ACCEL_Y);
 
-    osCreateProcess(accXCtrlProc, accXCtrlStack, ACC_X_CTRL_STACK_SIZE, &pidAccXCtrl, 2, NULL, &error);
-    osStartProcess(pidAccXCtrl, &error);
+    gameStartMs = timeNowMs();
+    releaseWorkers();
+}
 
-    osCreateProcess(accYCtrlProc, accYCtrlStack, ACC_Y_CTRL_STACK_SIZE, &pidAccYCtrl, 2, NULL, &error);
-    osStartProcess(pidAccYCtrl, &error);
+/*!
+ *  @brief    A procedure for pausing a running game.
+ *            The workers park at their next step and the
+ *            last of them snapshots the game state.
+ */
+void
+pauseGame(void)
+{
+    changeState(GAME_STATE_BIT(GAME_RUNNING), GAME_PAUSED, timeNowMs());
+}
+
+/*!
+ *  @brief    A procedure for resuming a paused game
+ *            from the pause snapshot. The time spent paused
+ *            does not count to the in-game time.
+ */
+void
+resumeGame(void)
+{
+    if (gameState != GAME_PAUSED) return;
+
+    waitWorkersParked();
+    if (gameState != GAME_PAUSED)
+    {
+        returnWorkersParked();
+        return;
+    }
+
+    restoreSnapshot(&pauseSnapshot);
+    releaseWorkers();
+}
+
+/*!
+ *  @brief    A function for copying the state of a paused
+ *            game, e.g. to keep it as a save state.
+ *  @param snapshot
+ *            A pointer to the snapshot to fill.
+ *  @returns  true if the game is paused and the
+ *            snapshot has been filled
+ */
+tBool
+gameSaveSnapshot(GameSnapshot *snapshot)
+{
+    if (gameState != GAME_PAUSED) return FALSE;
 
-    osCreateProcess(obstaclesCtrlProc, obstaclesCtrlStack, OBSTACLES_CTRL_STACK_SIZE, &pidObstaclesCtrl, 2, NULL, &error);
-    osStartProcess(pidObstaclesCtrl, &error);
+    waitWorkersParked();
+    *snapshot = pauseSnapshot;
+    returnWorkersParked();
+    return TRUE;
+}
 
-    osCreateProcess(gameTimeProc, gameTimeStack, GAME_TIME_STACK_SIZE, &pidGameTime, 2, NULL, &error);
-    osStartProcess(pidGameTime, &error);
+/*!
+ *  @brief    A function for replacing the state of a
+ *            paused game. The game continues from the
+ *            given snapshot on resume; with the same
+ *            snapshot and inputs it plays out the same.
+ *  @param snapshot
+ *            A pointer to the snapshot to load.
+ *  @returns  true if the game is paused and the
+ *            snapshot has been accepted
+ */
+tBool
+gameLoadSnapshot(const GameSnapshot *snapshot)
+{
+    if (gameState != GAME_PAUSED || snapshot->version != GAME_SNAPSHOT_VERSION) return FALSE;
 
-    // while(isInProgress);
+    waitWorkersParked();
+    pauseSnapshot = *snapshot;
+    returnWorkersParked();
+    return TRUE;
 }
 
 /*!
  *  @brief    A procedure for stopping the game,
  *            called on collisions or user's button click.
+ *            The game over screen is drawn by the last
+ *            worker to park, or here if the game was paused.
  */
 void
 stopGame(void)
 {
-    if (isInProgress == FALSE) return;
-    isInProgress = FALSE;
-    diodsShowOff(40);
-    displayScoreWindow();
-}
\ No newline at end of file
+    tU32 now = timeNowMs();
+
+    // the stop time is set with the state, before a worker can
+    // park and draw the score, see changeState
+    if (changeState(GAME_STATE_BIT(GAME_RUNNING), GAME_OVER, now)) return;
+
+    if (changeState(GAME_STATE_BIT(GAME_PAUSED), GAME_OVER, now))
+    {
+        waitWorkersParked();
+        showGameOver();
+        returnWorkersParked();
+    }
+}
@@ -13,8 +13,66 @@
 #ifndef _BALL_GAME_H_
 #define _BALL_GAME_H_
 
+#include "./wave.h"
+#include "./collision.h"
+
+#define MAX_OBSTACLES 12
+#define GAME_SNAPSHOT_VERSION 5
+
+typedef struct Ball
+{
+    tU16 xPos;
+    tU16 yPos;
+    tU8 speed;
+    tU8 radius;
+} Ball;
+
+typedef struct Obstacle
+{
+    tS16 xPos;
+    tS16 yPos;
+    tU8 speed;
+    tU8 height;
+    tU8 width;
+} Obstacle;
+
+/*
+ * Complete state of a game in progress, taken while the game is
+ * paused. Restoring it together with the same inputs replays the
+ * game the same way, so it serves as a save state as well.
+ */
+typedef struct GameSnapshot
+{
+    tU8 version;
+    tU32 gameTimeMs;
+    tU32 prngState;
+    Ball ball;
+    WaveState wave;
+    WaveRow nextRow;
+    tU8 numObstacles;
+    Obstacle obstacles[MAX_OBSTACLES];
+} GameSnapshot;
+
+typedef enum GameState
+{
+    GAME_IDLE,
+    GAME_COUNTDOWN,
+    GAME_RUNNING,
+    GAME_PAUSED,
+    GAME_OVER
+} GameState;
+
+#define GAME_STATE_BIT(state) (tU8)(1u << (state))
+
+void initGame(void);
+GameState getGameState(void);
+CollisionMap *gameBorrowObstacleMap(void);
 tU32 getScore(void);
 void startGame(void);
+void pauseGame(void);
+void resumeGame(void);
 void stopGame(void);
+tBool gameSaveSnapshot(GameSnapshot *snapshot);
+tBool gameLoadSnapshot(const GameSnapshot *snapshot);
 
 #endif
@@ -0,0 +1,206 @@
+/******************************************************************************
+ *
+ * Copyright:
+ *    Byczki(TM)
+ *
+ * File:
+ *    bench.c
+ *
+ * Description:
+ *    Implement micro-benchmarks of the hot paths: LCD transfers, ADC
+ *    reads, collision tests and I2C transfers. Every benchmark is run
+ *    a few times and the fastest run is reported, so OS ticks and
+ *    preemption do not skew the result. The report also shows whether
+ *    each function runs from RAM or flash, so builds with and without
+ *    FAST_CSRCS can be compared.
+ *
+ *    The collision benchmark borrows the obstacle map of the game, so
+ *    no RAM is kept for it.
+ *
+ *****************************************************************************/
+
+#include "pre_emptive_os/api/osapi.h"
+#include <printf_P.h>
+#include "./lcd.h"
+#include "./lcd_hw.h"
+#include "./adc.h"
+#include "./sampler.h"
+#include "./pca9532.h"
+#include "./collision.h"
+#include "./systime.h"
+#include "./ball_game.h"
+#include "./bench.h"
+
+#define BENCH_RUNS 4
+#define BENCH_PIXELS 1024
+#define BENCH_ADC_READS 64
+#define BENCH_COLLISION_TESTS (LCD_WIDTH - 8)
+#define BENCH_I2C_READS 16
+#define RAM_START 0x40000000
+
+typedef struct Benchmark
+{
+    const char *name;
+    void (*run)(void);
+    void *function;
+    tU32 count;
+} Benchmark;
+
+static void rectBench(void);
+static void pixelBench(void);
+static void adcBench(void);
+static void collisionBench(void);
+static void i2cBench(void);
+
+static const Benchmark benchmarks[] =
+{
+    { "lcdRect 128x128", rectBench, (void *)lcdRect, LCD_WIDTH * LCD_HEIGHT },
+    { "lcdWrdata", pixelBench, (void *)sendToLCD, BENCH_PIXELS },
+    { "getAnalogueInput1", adcBench, (void *)getAnalogueInput1, BENCH_ADC_READS },
+    { "collisionTest", collisionBench, (void *)collisionTest, BENCH_COLLISION_TESTS },
+    { "getPca9532Pin", i2cBench, (void *)getPca9532Pin, BENCH_I2C_READS }
+};
+
+#define K SPRITE_KEY
+#define W WHITE
+static const tU8 probePixels[] =
+{
+    K, K, W, W, W, W, K, K,
+    K, W, W, W, W, W, W, K,
+    W, W, W, W, W, W, W, W,
+    W, W, W, W, W, W, W, W,
+    W, W, W, W, W, W, W, W,
+    W, W, W, W, W, W, W, W,
+    K, W, W, W, W, W, W, K,
+    K, K, W, W, W, W, K, K
+};
+#undef K
+#undef W
+
+static const SpriteImage probeImage = { 8, 8, SPRITE_KEY, probePixels };
+static CollisionMask probeMask;
+static CollisionMap *probeMap;
+
+#define NUM_BENCHMARKS (sizeof(benchmarks) / sizeof(benchmarks[0]))
+
+/*!
+ *  @brief    Benchmark of a full screen fill.
+ */
+static void
+rectBench(void)
+{
+    lcdRect(0, 0, LCD_WIDTH, LCD_HEIGHT, BLACK);
+}
+
+/*!
+ *  @brief    Benchmark of a pixel stream, as sent
+ *            by the sprites and the tile map.
+ */
+static void
+pixelBench(void)
+{
+    tU16 i;
+
+    lcdStartWrite(0, 0, LCD_WIDTH, BENCH_PIXELS / LCD_WIDTH);
+    for (i = 0; i < BENCH_PIXELS; i++)
+        lcdWrdata((tU8)i);
+    lcdEndWrite();
+}
+
+/*!
+ *  @brief    Benchmark of the accelerometer reads. The
+ *            sampler is stopped meanwhile, as otherwise
+ *            the reads return its cached sample instead
+ *            of converting.
+ */
+static void
+adcBench(void)
+{
+    tBool sampling = samplerIsRunning();
+    tU8 i;
+
+    samplerStop();
+    for (i = 0; i < BENCH_ADC_READS; i++)
+        getAnalogueInput1(ACCEL_X);
+    if (sampling)
+        samplerStart();
+}
+
+/*!
+ *  @brief    Benchmark of the collision test. A sprite
+ *            is moved along a line crossing the map where
+ *            it never hits, so every test reads all the
+ *            rows it spans.
+ */
+static void
+collisionBench(void)
+{
+    tU8 x;
+
+    for (x = 0; x < BENCH_COLLISION_TESTS; x++)
+        collisionTest(probeMap, &probeMask, x, LCD_HEIGHT / 2 - 4);
+}
+
+/*!
+ *  @brief    Benchmark of I2C reads from the LED
+ *            driver, a one-byte write and a three-byte
+ *            read each.
+ */
+static void
+i2cBench(void)
+{
+    tU8 i;
+
+    for (i = 0; i < BENCH_I2C_READS; i++)
+        getPca9532Pin();
+}
+
+/*!
+ *  @brief    A function for running all the benchmarks
+ *            and printing the report. The benchmarks draw
+ *            over the screen, so they are refused while
+ *            a game is in progress.
+ *  @returns  true if the benchmarks have been run
+ */
+tBool
+benchRun(void)
+{
+    tU8 i;
+    tU8 run;
+
+    probeMap = gameBorrowObstacleMap();
+    if (probeMap == NULL) return FALSE;
+
+    // obstacles above and below the line of the collision benchmark
+    collisionMaskInit(&probeMask, &probeImage);
+    collisionClear(probeMap);
+    for (i = 0; i < LCD_WIDTH; i += 16)
+    {
+        collisionFill(probeMap, i, LCD_HEIGHT / 2 - 12, 12, 8, TRUE);
+        collisionFill(probeMap, i, LCD_HEIGHT / 2 + 4, 12, 8, TRUE);
+    }
+
+    printf("benchmark           runs from  total us  ns/item\n");
+    for (i = 0; i < NUM_BENCHMARKS; i++)
+    {
+        const Benchmark *bench = &benchmarks[i];
+        tU32 best = 0xffffffff;
+        tU32 us;
+
+        for (run = 0; run < BENCH_RUNS; run++)
+        {
+            tU32 start = timeCycles();
+            bench->run();
+            tU32 cycles = timeCycles() - start;
+            if (cycles < best) best = cycles;
+        }
+
+        us = timeCyclesToUs(best);
+        printf("%s  %s  %u  %u\n", bench->name,
+               (tU32)bench->function >= RAM_START ? "RAM" : "flash",
+               us, us * 1000 / bench->count);
+    }
+
+    lcdClrscr();
+    return TRUE;
+}
@@ -0,0 +1,20 @@
+/******************************************************************************
+ *
+ * Copyright:
+ *    Byczki(TM)
+ *
+ * File:
+ *    bench.h
+ *
+ * Description:
+ *    Expose the on-target micro-benchmarks.
+ *
+ *****************************************************************************/
+#ifndef _BENCH_H_
+#define _BENCH_H_
+
+#include <general.h>
+
+tBool benchRun(void);
+
+#endif
@@ -70,6 +70,18 @@ RAM_EXEC = -DRAM_EXEC
 else
 RAM_EXEC =
 endif
+
+ifeq (1, $(OS_BENCH))
+OS_BENCH_DEF = -DOS_BENCH
+else
+OS_BENCH_DEF =
+endif
+
+ifeq (1, $(NO_FASTCODE))
+FASTCODE_DEF = -DNO_FASTCODE
+else
+FASTCODE_DEF =
+endif
 #----------------------------------------------------------------------
 # COMPILER AND ASSEMBLER OPTIONS
 #----------------------------------------------------------------------
@@ -81,7 +93,7 @@ W_OPTS    = -Wall -Wcast-align -Wcast-qual -Wimplicit \
 
 CPU       = arm7tdmi
 OPTS      = -mcpu=$(CPU) $(THUMB_IW)
-CA_OPTS   = $(OPTS) $(INC) -DEL -DGCC $(THUMB_IW) $(T_FLAGS) $(EFLAGS) -D$(CPU_VARIANT) $(RAM_EXEC)
+CA_OPTS   = $(OPTS) $(INC) -DEL -DGCC $(THUMB_IW) $(T_FLAGS) $(EFLAGS) -D$(CPU_VARIANT) $(RAM_EXEC) $(OS_BENCH_DEF) $(FASTCODE_DEF)
 CC_OPTS   = $(CA_OPTS) $(OFLAGS) $(DBFLAGS) $(W_OPTS) -Wa,-ahlms=$(<:.c=.lst)
 CC_OPTS_A = $(CA_OPTS) -x assembler-with-cpp -gstabs -Wa,-alhms=$(<:.S=.lst)
 
@@ -523,6 +535,18 @@ endif
 #----------------------------------------------------------------------
 OBJS ?= $(CSRCS:.c=.o) $(ASRCS:.S=.o)
 
+#----------------------------------------------------------------------
+# ARM CODE RUN FROM RAM (FASTCODE)
+#----------------------------------------------------------------------
+ifdef FAST_CSRCS
+ifndef FAST_OFLAGS
+FAST_OFLAGS = $(OFLAGS)
+endif
+$(FAST_CSRCS:.c=.o): T_FLAGS = -marm
+$(FAST_CSRCS:.c=.o): OFLAGS := $(FAST_OFLAGS)
+$(FAST_CSRCS:.c=.o): EFLAGS += -mlong-calls
+endif
+
 #----------------------------------------------------------------------
 # BUILD RULES
 #----------------------------------------------------------------------
@@ -572,6 +596,75 @@ endif
 endif
 
 
+#----------------------------------------------------------------------
+# BUILD VARIANT MATRIX
+# Rebuilds the program for every CODE and OFLAGS combination, keeps
+# a hex file per variant and prints a table of their sizes, taken
+# from the output sections in the map file. Timing is measured on
+# target: download a variant and run "bench" on the console. The
+# FASTCODE tag is turned off with NO_FASTCODE, so every function
+# stays in flash and the variants differ only in the two settings.
+# The libraries in SUBDIRS are built once, as usual.
+#----------------------------------------------------------------------
+MATRIX_CODE   ?= ARM THUMB
+MATRIX_OFLAGS ?= -Os -O2 -O3
+MATRIX_DIR    ?= matrix
+MATRIX_MAKE    = $(MAKE) --no-print-directory SUBDIRS= FAST_CSRCS= NO_FASTCODE=1
+
+matrix: pre_all
+	@mkdir -p $(MATRIX_DIR)
+	@$(RM) $(MATRIX_DIR)/sizes.txt
+	@for code in $(MATRIX_CODE) ; do \
+	  for opt in $(MATRIX_OFLAGS) ; do \
+	    variant=$$code$$opt ; \
+	    echo "Building $$variant" ; \
+	    $(MATRIX_MAKE) CODE=$$code OFLAGS=$$opt clean > /dev/null ; \
+	    $(MATRIX_MAKE) CODE=$$code OFLAGS=$$opt depend $(TARGET) \
+	      > $(MATRIX_DIR)/$$variant.log 2>&1 || exit 1 ; \
+	    cp $(TARGET) $(MATRIX_DIR)/$(NAME)_$$variant.hex ; \
+	    cp $(NAME).map $(MATRIX_DIR)/$(NAME)_$$variant.map ; \
+	    $(AWK) -v v=$$variant \
+	      'function hex(s,  n, i) { n = 0; s = tolower(substr(s, 3)); \
+	         for (i = 1; i <= length(s); i++) \
+	           n = n * 16 + index("0123456789abcdef", substr(s, i, 1)) - 1; \
+	         return n } \
+	       /^\.(text|rodata)[ \t]/ && NF >= 3 { t += hex($$3) } \
+	       /^\.data[ \t]/ && NF >= 3 { d = hex($$3) } \
+	       /^\.bss[ \t]/  && NF >= 3 { b = hex($$3) } \
+	       END { printf "   %-10s %7d %7d %7d %7d %7d\n", v,t,d,b,t+d,d+b }' \
+	      $(NAME).map >> $(MATRIX_DIR)/sizes.txt ; \
+	  done ; \
+	done
+	@$(MATRIX_MAKE) clean > /dev/null
+	@echo ""
+	@echo "=== Build variants ======================================="
+	@echo ""
+	@echo "   VARIANT       TEXT    DATA     BSS     ROM     RAM"
+	@echo "   =======       ====    ====     ===     ===     ==="
+	@cat $(MATRIX_DIR)/sizes.txt
+	@echo ""
+	@echo "   Hex, map files and build logs are in $(MATRIX_DIR)/"
+	@echo ""
+
+#----------------------------------------------------------------------
+# OS BENCHMARK FIRMWARE
+# Builds the program with OS_BENCH defined into a hex file of its own.
+# That firmware runs the OS micro-benchmarks at start-up instead of
+# the game and prints the results on the console; "osbench" on the
+# console runs them again. The objects are cleaned before and after,
+# so the normal build is not mixed with the benchmark one.
+#----------------------------------------------------------------------
+OSBENCH_MAKE = $(MAKE) --no-print-directory SUBDIRS= OS_BENCH=1
+
+osbench: pre_all
+	@$(OSBENCH_MAKE) clean > /dev/null
+	@$(OSBENCH_MAKE) depend $(TARGET)
+	@cp $(TARGET) $(NAME)_osbench.hex
+	@$(OSBENCH_MAKE) clean > /dev/null
+	@echo ""
+	@echo "   Benchmark firmware is in $(NAME)_osbench.hex"
+	@echo ""
+
 #----------------------------------------------------------------------
 # CODE SIZE
 #----------------------------------------------------------------------
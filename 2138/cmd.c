@@ -0,0 +1,421 @@
+/******************************************************************************
+ *
+ * Copyright:
+ *    Byczki(TM)
+ *
+ * File:
+ *    cmd.c
+ *
+ * Description:
+ *    Implement a minimal console command interpreter. Characters are
+ *    read from the console without blocking and collected into a
+ *    line, a complete line is looked up in the command table by its
+ *    first word.
+ *
+ *    The UART has no receive FIFO enabled, so a character that is
+ *    not read before the next one arrives is lost. cmdInit therefore
+ *    moves the characters into a ring from the receive interrupt, and
+ *    cmdPoll falls back to reading the UART only if the interrupt
+ *    could not be registered.
+ *
+ *****************************************************************************/
+
+#include "pre_emptive_os/api/osapi.h"
+#include <printf_P.h>
+#include <consol.h>
+#include <lpc2xxx.h>
+#include "./load.h"
+#include "./stackmon.h"
+#include "./difficulty.h"
+#include "./bench.h"
+#include "./irq.h"
+#include "./periodic.h"
+#include "./pool.h"
+#include "./mutex.h"
+#include "./osbench.h"
+#include "./ring.h"
+#include "./cmd.h"
+
+typedef struct CmdEntry
+{
+    const char *name;
+    void (*handler)(char *args);
+    const char *help;
+} CmdEntry;
+
+static void helpCmd(char *args);
+static void loadCmd(char *args);
+static void stackCmd(char *args);
+static void difficultyCmd(char *args);
+static void benchCmd(char *args);
+static void osBenchCmd(char *args);
+static void irqCmd(char *args);
+static void tasksCmd(char *args);
+static void poolsCmd(char *args);
+static void locksCmd(char *args);
+
+static const CmdEntry commands[] =
+{
+    { "help", helpCmd, "list commands" },
+    { "load", loadCmd, "CPU load per process" },
+    { "stack", stackCmd, "stack peaks and recommended sizes" },
+    { "tasks", tasksCmd, "periodic task releases and overruns" },
+    { "pools", poolsCmd, "memory pool usage and peaks" },
+    { "locks", locksCmd, "LCD and I2C lock contention and hold times" },
+    { "irq", irqCmd, "interrupt counts, durations and latencies" },
+    { "bench", benchCmd, "time the LCD and ADC hot paths" },
+    { "osbench", osBenchCmd, "time OS calls, switches and sleep jitter" },
+    { "diff", difficultyCmd, "diff [reset | <entry> <delay> <spacing%> <minSpeed> <maxSpeed> <ballSpeed> <wave>]" }
+};
+
+#define IRQ_PROBES 8
+
+#define RX_RING_SIZE 64 /* a power of two, see ringInit */
+#define RX_IRQ_SLOT 8
+#define UART_IER_RDA 0x01
+#define UART_LSR_RDR 0x01
+
+#define NUM_COMMANDS (sizeof(commands) / sizeof(commands[0]))
+
+static char line[CMD_LINE_SIZE];
+static tU8 lineLength;
+
+static Ring rxRing;
+static RING_STORAGE(rxRingArea, RX_RING_SIZE, sizeof(char));
+static tBool rxInterrupt = FALSE;
+
+/*!
+ *  @brief    A function for comparing two strings.
+ *  @returns  true if the strings are equal
+ */
+static tBool
+isEqual(const char *a, const char *b)
+{
+    while (*a != '\0' && *a == *b)
+    {
+        a++;
+        b++;
+    }
+    return *a == *b;
+}
+
+/*!
+ *  @brief    A function for removing the spaces around
+ *            a string, in place.
+ *  @param string
+ *            The string to trim.
+ *  @returns  the first character that is not a space
+ */
+static char *
+trim(char *string)
+{
+    char *end;
+
+    while (*string == ' ') string++;
+    end = string;
+    while (*end != '\0') end++;
+    while (end > string && end[-1] == ' ') end--;
+    *end = '\0';
+    return string;
+}
+
+/*!
+ *  @brief    A function for splitting the next word
+ *            off a line.
+ *  @param args
+ *            A pointer to the rest of the line, advanced
+ *            past the word.
+ *  @returns  the word, or NULL at the end of the line
+ */
+static char *
+nextWord(char **args)
+{
+    char *word = *args;
+
+    while (*word == ' ') word++;
+    if (*word == '\0') return NULL;
+
+    *args = word;
+    while (**args != ' ' && **args != '\0') (*args)++;
+    if (**args == ' ') *(*args)++ = '\0';
+    return word;
+}
+
+/*!
+ *  @brief    A function for parsing the next word
+ *            of a line as a decimal number.
+ *  @param args
+ *            A pointer to the rest of the line.
+ *  @param value
+ *            Returns the number.
+ *  @returns  true if a number has been parsed
+ */
+static tBool
+nextNumber(char **args, tU16 *value)
+{
+    char *word = nextWord(args);
+    tU32 number = 0;
+
+    if (word == NULL) return FALSE;
+    for (; *word != '\0'; word++)
+    {
+        if (*word < '0' || *word > '9') return FALSE;
+        number = number * 10 + (*word - '0');
+        if (number > 0xffff) return FALSE;
+    }
+    *value = (tU16)number;
+    return TRUE;
+}
+
+/*!
+ *  @brief    A procedure printing the command list.
+ */
+static void
+helpCmd(char *args)
+{
+    tU8 i;
+
+    for (i = 0; i < NUM_COMMANDS; i++)
+        printf("%s - %s\n", commands[i].name, commands[i].help);
+}
+
+/*!
+ *  @brief    A procedure printing the CPU load.
+ */
+static void
+loadCmd(char *args)
+{
+    loadReport();
+}
+
+/*!
+ *  @brief    A procedure printing the stack report.
+ */
+static void
+stackCmd(char *args)
+{
+    stackMonReport();
+}
+
+/*!
+ *  @brief    A procedure printing the periodic tasks.
+ */
+static void
+tasksCmd(char *args)
+{
+    periodicReport();
+}
+
+/*!
+ *  @brief    A procedure printing the memory pools.
+ */
+static void
+poolsCmd(char *args)
+{
+    poolReport();
+}
+
+/*!
+ *  @brief    A procedure printing the mutex statistics.
+ */
+static void
+locksCmd(char *args)
+{
+    mutexReport();
+}
+
+/*!
+ *  @brief    A procedure probing the entry latency of
+ *            all the registered interrupt sources and
+ *            printing their statistics.
+ */
+static void
+irqCmd(char *args)
+{
+    IrqStats stats;
+    tU8 source;
+    tU8 i;
+
+    for (source = 0; source < IRQ_SOURCES; source++)
+    {
+        if (irqGetStats(source, &stats) == FALSE) continue;
+        for (i = 0; i < IRQ_PROBES; i++)
+            irqProbe(source);
+    }
+    irqReport();
+}
+
+/*!
+ *  @brief    A procedure running the benchmarks.
+ */
+static void
+benchCmd(char *args)
+{
+    if (benchRun() == FALSE) printf("stop the game first\n");
+}
+
+/*!
+ *  @brief    A procedure running the OS benchmarks.
+ */
+static void
+osBenchCmd(char *args)
+{
+    osBenchRun();
+}
+
+/*!
+ *  @brief    A procedure printing or tuning the
+ *            difficulty curve.
+ *  @param args
+ *            Nothing to print the curve, "reset" to
+ *            restore the compiled-in one or an entry
+ *            index followed by all its fields.
+ */
+static void
+difficultyCmd(char *args)
+{
+    DifficultyLevel level;
+    char *rest;
+    tU16 index;
+    tU16 values[6];
+    tU8 i;
+
+    args = trim(args);
+    rest = args;
+    if (*args != '\0')
+    {
+        if (isEqual(args, "reset"))
+        {
+            difficultyReset();
+        }
+        else
+        {
+            tBool ok = nextNumber(&rest, &index);
+            for (i = 0; i < 6 && ok; i++)
+                ok = nextNumber(&rest, &values[i]);
+
+            level.obstacleDelayMs = values[0];
+            level.spacingPercent = (tU8)values[1];
+            level.minSpeed = (tU8)values[2];
+            level.maxSpeed = (tU8)values[3];
+            level.ballSpeed = (tU8)values[4];
+            level.waveLevel = (tU8)values[5];
+            if (ok == FALSE || values[1] > 255 || difficultySetEntry((tU8)index, &level) == FALSE)
+            {
+                printf("invalid entry\n");
+                return;
+            }
+        }
+    }
+
+    printf("time  delay  spacing  speed  ball  wave\n");
+    for (i = 0; difficultyGetEntry(i, &level); i++)
+    {
+        printf("%ds  %d  %d%%  %d-%d  %d  %d\n",
+               i * (DIFFICULTY_STEP_MS / 1000), level.obstacleDelayMs, level.spacingPercent,
+               level.minSpeed, level.maxSpeed, level.ballSpeed, level.waveLevel);
+    }
+}
+
+/*!
+ *  @brief    A procedure for running a complete line.
+ */
+static void
+runLine(void)
+{
+    char *args = line;
+    char *name = nextWord(&args);
+    tU8 i;
+
+    if (name == NULL) return;
+    for (i = 0; i < NUM_COMMANDS; i++)
+    {
+        if (isEqual(name, commands[i].name))
+        {
+            commands[i].handler(args);
+            return;
+        }
+    }
+    printf("unknown command, try help\n");
+}
+
+/*!
+ *  @brief    Handler of the UART0 receive interrupt,
+ *            moving the received characters to the ring.
+ *            Reading the receive register clears the
+ *            interrupt.
+ */
+static void
+rxHandler(void)
+{
+    while (U0LSR & UART_LSR_RDR)
+    {
+        char ch = U0RBR;
+        ringPush(&rxRing, &ch);
+    }
+}
+
+/*!
+ *  @brief    A function for reading a received
+ *            character without blocking.
+ *  @param ch
+ *            Returns the character.
+ *  @returns  true if a character has been read
+ */
+static tBool
+readChar(char *ch)
+{
+    if (rxInterrupt) return ringPop(&rxRing, ch);
+    return consolGetChar(ch) ? TRUE : FALSE;
+}
+
+/*!
+ *  @brief    A procedure for registering the console
+ *            receive interrupt. Must be called once
+ *            after consolInit, cmdPoll polls the UART
+ *            if it is not called or fails.
+ */
+void
+cmdInit(void)
+{
+    ringInit(&rxRing, rxRingArea, sizeof(char), RX_RING_SIZE);
+    if (irqRegister(IRQ_SOURCE_UART0, rxHandler, RX_IRQ_SLOT) == FALSE)
+    {
+        printf("cmd: no interrupt for the console, polling\n");
+        return;
+    }
+    rxInterrupt = TRUE;
+    U0IER = UART_IER_RDA;
+}
+
+/*!
+ *  @brief    A procedure to be called regularly from
+ *            a process loop. It reads all the characters
+ *            received from the console and runs a command
+ *            once a line is complete.
+ */
+void
+cmdPoll(void)
+{
+    char ch;
+
+    while (readChar(&ch))
+    {
+        if (ch == '\r' || ch == '\n')
+        {
+            printf("\n");
+            line[lineLength] = '\0';
+            runLine();
+            lineLength = 0;
+        }
+        else if (ch == '\b' && lineLength > 0)
+        {
+            lineLength--;
+        }
+        else if (ch >= ' ' && lineLength < CMD_LINE_SIZE - 1)
+        {
+            line[lineLength++] = ch;
+            consolSendCh(ch);
+        }
+    }
+}
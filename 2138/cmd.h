@@ -0,0 +1,23 @@
+/******************************************************************************
+ *
+ * Copyright:
+ *    Byczki(TM)
+ *
+ * File:
+ *    cmd.h
+ *
+ * Description:
+ *    Expose the console command interpreter.
+ *
+ *****************************************************************************/
+#ifndef _CMD_H_
+#define _CMD_H_
+
+#include <general.h>
+
+#define CMD_LINE_SIZE 48
+
+void cmdInit(void);
+void cmdPoll(void);
+
+#endif
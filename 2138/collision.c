@@ -0,0 +1,206 @@
+/******************************************************************************
+ *
+ * Copyright:
+ *    Byczki(TM)
+ *
+ * File:
+ *    collision.c
+ *
+ * Description:
+ *    Implement a pixel-exact collision test. Obstacles are kept in
+ *    a screen-wide occupancy map of 128-bit rows and a sprite is
+ *    tested by AND-ing its row masks with the rows of the map it
+ *    spans, so the cost is a few word operations per sprite row
+ *    whatever the shape of the sprite.
+ *
+ *****************************************************************************/
+
+#include "pre_emptive_os/api/osapi.h"
+#include "./collision.h"
+
+#if LCD_WIDTH % MASK_WORD_BITS != 0
+#error The screen width must be a multiple of the mask word size
+#endif
+
+/*!
+ *  @brief    A function for building a mask with
+ *            the bits first..last of a word set.
+ *  @param first
+ *            Lowest bit to set, 0-31.
+ *  @param last
+ *            Highest bit to set, first-31.
+ *  @returns  the mask
+ */
+static tU32
+bitRange(tU8 first, tU8 last)
+{
+    tU32 upper = last == MASK_WORD_BITS - 1 ? 0xffffffff : (1ul << (last + 1)) - 1;
+    return upper & ~((1ul << first) - 1);
+}
+
+/*!
+ *  @brief    A function checking a single pixel
+ *            of the map.
+ *  @param map
+ *            A pointer to the map.
+ *  @param x
+ *            Screen x-coordinate of the pixel.
+ *  @param y
+ *            Screen y-coordinate of the pixel.
+ *  @returns  true if the pixel is occupied, false if
+ *            it is free or off the map
+ */
+tBool
+collisionIsSet(const CollisionMap *map, tU8 x, tU8 y)
+{
+    if (x >= LCD_WIDTH || y >= LCD_HEIGHT) return FALSE;
+    return (map->rows[y][x / MASK_WORD_BITS] >> (x % MASK_WORD_BITS)) & 1;
+}
+
+/*!
+ *  @brief    A procedure for removing everything
+ *            from the map.
+ *  @param map
+ *            A pointer to the map to clear.
+ */
+void
+collisionClear(CollisionMap *map)
+{
+    tU8 row;
+    tU8 k;
+
+    for (row = 0; row < LCD_HEIGHT; row++)
+    {
+        for (k = 0; k < MASK_WORDS; k++)
+            map->rows[row][k] = 0;
+    }
+}
+
+/*!
+ *  @brief    A procedure for setting or clearing
+ *            a rectangle of the map, clipped to the
+ *            screen. The row mask is built once and
+ *            applied to every row of the rectangle.
+ *  @param map
+ *            A pointer to the map to change.
+ *  @param x
+ *            Left edge of the rectangle.
+ *  @param y
+ *            Top edge of the rectangle.
+ *  @param xLen
+ *            Width of the rectangle.
+ *  @param yLen
+ *            Height of the rectangle.
+ *  @param set
+ *            True to mark the rectangle as occupied,
+ *            false to free it.
+ */
+void
+collisionFill(CollisionMap *map, tS16 x, tS16 y, tS16 xLen, tS16 yLen, tBool set)
+{
+    tS16 right = x + xLen - 1;
+    tS16 bottom = y + yLen - 1;
+    tU32 span[MASK_WORDS];
+    tS16 row;
+    tU8 k;
+
+    if (xLen <= 0 || yLen <= 0) return;
+    if (right < 0 || bottom < 0 || x >= LCD_WIDTH || y >= LCD_HEIGHT) return;
+
+    if (x < 0) x = 0;
+    if (y < 0) y = 0;
+    if (right >= LCD_WIDTH) right = LCD_WIDTH - 1;
+    if (bottom >= LCD_HEIGHT) bottom = LCD_HEIGHT - 1;
+
+    for (k = 0; k < MASK_WORDS; k++)
+    {
+        tS16 first = k * MASK_WORD_BITS;
+        tS16 last = first + MASK_WORD_BITS - 1;
+
+        if (right < first || x > last) span[k] = 0;
+        else span[k] = bitRange(x > first ? x - first : 0,
+                                right < last ? right - first : MASK_WORD_BITS - 1);
+    }
+
+    for (row = y; row <= bottom; row++)
+    {
+        tU32 *words = map->rows[row];
+        for (k = 0; k < MASK_WORDS; k++)
+        {
+            if (set) words[k] |= span[k];
+            else words[k] &= ~span[k];
+        }
+    }
+}
+
+/*!
+ *  @brief    A procedure for decoding the opaque
+ *            pixels of a sprite image into row masks.
+ *  @param mask
+ *            A pointer to the mask to initialize.
+ *  @param image
+ *            A pointer to the flash-resident image, at most
+ *            MASK_WORD_BITS wide and SPRITE_MAX_HEIGHT high.
+ */
+void
+collisionMaskInit(CollisionMask *mask, const SpriteImage *image)
+{
+    tU8 row;
+    tU8 col;
+
+    mask->width = image->width < MASK_WORD_BITS ? image->width : MASK_WORD_BITS;
+    mask->height = image->height < SPRITE_MAX_HEIGHT ? image->height : SPRITE_MAX_HEIGHT;
+
+    for (row = 0; row < mask->height; row++)
+    {
+        const tU8 *pixels = &image->pixels[row * image->width];
+        tU32 bits = 0;
+        for (col = 0; col < mask->width; col++)
+        {
+            if (pixels[col] != image->colorKey) bits |= 1ul << col;
+        }
+        mask->rows[row] = bits;
+    }
+}
+
+/*!
+ *  @brief    A function checking if any opaque pixel
+ *            of a sprite overlaps an occupied pixel of
+ *            the map. Only the map rows spanned by the
+ *            sprite are read, and each sprite row touches
+ *            at most two words of them.
+ *  @param map
+ *            A pointer to the occupancy map.
+ *  @param mask
+ *            A pointer to the sprite mask.
+ *  @param x
+ *            Screen x-coordinate of the sprite.
+ *  @param y
+ *            Screen y-coordinate of the sprite.
+ *  @returns  true if the sprite collides with the map
+ */
+tBool
+collisionTest(const CollisionMap *map, const CollisionMask *mask, tS16 x, tS16 y)
+{
+    tS16 word = x >= 0 ? x / MASK_WORD_BITS : -1;
+    tU8 shift = (tU8)(x - word * MASK_WORD_BITS);
+    tU8 row;
+
+    for (row = 0; row < mask->height; row++)
+    {
+        const tU32 *words;
+        tU32 bits = mask->rows[row];
+        tS16 screenRow = y + row;
+
+        if (bits == 0 || screenRow < 0) continue;
+        if (screenRow >= LCD_HEIGHT) break;
+
+        words = map->rows[screenRow];
+        if (word >= 0 && word < MASK_WORDS && (words[word] & (bits << shift)))
+            return TRUE;
+        if (shift != 0 && word + 1 < MASK_WORDS &&
+            (words[word + 1] & (bits >> (MASK_WORD_BITS - shift))))
+            return TRUE;
+    }
+    return FALSE;
+}
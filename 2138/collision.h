@@ -0,0 +1,49 @@
+/******************************************************************************
+ *
+ * Copyright:
+ *    Byczki(TM)
+ *
+ * File:
+ *    collision.h
+ *
+ * Description:
+ *    Expose public functions and types of the bitmask collision test.
+ *
+ *****************************************************************************/
+#ifndef _COLLISION_H_
+#define _COLLISION_H_
+
+#include <general.h>
+#include "./lcd.h"
+#include "./sprite.h"
+
+#define MASK_WORD_BITS 32
+#define MASK_WORDS (LCD_WIDTH / MASK_WORD_BITS)
+
+/*
+ * Occupancy of the whole screen, one bit per pixel. Bit n of
+ * rows[y][k] stands for the pixel at x = k * MASK_WORD_BITS + n.
+ */
+typedef struct CollisionMap
+{
+    tU32 rows[LCD_HEIGHT][MASK_WORDS];
+} CollisionMap;
+
+/*
+ * Opaque pixels of a sprite, one word per image row, decoded once
+ * in collisionMaskInit. Bit n stands for image column n.
+ */
+typedef struct CollisionMask
+{
+    tU8 width;
+    tU8 height;
+    tU32 rows[SPRITE_MAX_HEIGHT];
+} CollisionMask;
+
+void collisionClear(CollisionMap *map);
+void collisionFill(CollisionMap *map, tS16 x, tS16 y, tS16 xLen, tS16 yLen, tBool set);
+void collisionMaskInit(CollisionMask *mask, const SpriteImage *image);
+tBool collisionIsSet(const CollisionMap *map, tU8 x, tU8 y);
+tBool collisionTest(const CollisionMap *map, const CollisionMask *mask, tS16 x, tS16 y);
+
+#endif
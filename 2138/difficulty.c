@@ -0,0 +1,142 @@
+/******************************************************************************
+ *
+ * Copyright:
+ *    Byczki(TM)
+ *
+ * File:
+ *    difficulty.c
+ *
+ * Description:
+ *    Implement the difficulty curve. The difficulty is a function of
+ *    the in-game time only: it is looked up in a table, with the
+ *    obstacle delay and the row spacing interpolated linearly between
+ *    entries. Only integer arithmetic and no hardware is used, so the
+ *    curve is the same on the board and in a host build. The table
+ *    is copied from flash on first use or by difficultyReset, and can
+ *    be tuned at run time.
+ *
+ *****************************************************************************/
+
+#include "./difficulty.h"
+
+static const DifficultyLevel defaultCurve[DIFFICULTY_ENTRIES] =
+{
+    /* delay, spacing, min speed, max speed, ball speed, wave level */
+    { 200, 100, 1, 2, 5, 0 },
+    { 170, 100, 1, 3, 5, 1 },
+    { 145, 95, 1, 3, 5, 1 },
+    { 125, 90, 2, 4, 6, 2 },
+    { 105, 85, 2, 4, 6, 2 },
+    { 90, 80, 2, 5, 6, 3 },
+    { 75, 75, 3, 5, 7, 3 },
+    { 60, 70, 3, 5, 7, 3 }
+};
+
+static DifficultyLevel curve[DIFFICULTY_ENTRIES];
+static tBool curveValid = FALSE;
+
+/*!
+ *  @brief    A function for interpolating linearly
+ *            between two values.
+ *  @param from
+ *            Value at the start of the step.
+ *  @param to
+ *            Value at the end of the step.
+ *  @param ms
+ *            Time into the step, below DIFFICULTY_STEP_MS.
+ *  @returns  the interpolated value
+ */
+static tU16
+interpolate(tU16 from, tU16 to, tU32 ms)
+{
+    tS32 delta = (tS32)to - (tS32)from;
+    return (tU16)(from + delta * (tS32)ms / DIFFICULTY_STEP_MS);
+}
+
+/*!
+ *  @brief    A procedure for restoring the compiled-in
+ *            difficulty curve.
+ */
+void
+difficultyReset(void)
+{
+    tU8 i;
+
+    for (i = 0; i < DIFFICULTY_ENTRIES; i++)
+        curve[i] = defaultCurve[i];
+    curveValid = TRUE;
+}
+
+/*!
+ *  @brief    A procedure for reading the difficulty at
+ *            a given in-game time.
+ *  @param gameMs
+ *            In-game time in milliseconds.
+ *  @param level
+ *            A pointer to the level to fill.
+ */
+void
+difficultyAt(tU32 gameMs, DifficultyLevel *level)
+{
+    tU32 index = gameMs / DIFFICULTY_STEP_MS;
+    const DifficultyLevel *from;
+    const DifficultyLevel *to;
+    tU32 ms;
+
+    if (curveValid == FALSE) difficultyReset();
+
+    if (index >= DIFFICULTY_ENTRIES - 1)
+    {
+        *level = curve[DIFFICULTY_ENTRIES - 1];
+        return;
+    }
+
+    from = &curve[index];
+    to = &curve[index + 1];
+    ms = gameMs % DIFFICULTY_STEP_MS;
+
+    *level = *from;
+    level->obstacleDelayMs = interpolate(from->obstacleDelayMs, to->obstacleDelayMs, ms);
+    level->spacingPercent = (tU8)interpolate(from->spacingPercent, to->spacingPercent, ms);
+}
+
+/*!
+ *  @brief    A function for reading an entry of the curve.
+ *  @param index
+ *            Index of the entry, 0 to DIFFICULTY_ENTRIES - 1.
+ *  @param level
+ *            A pointer to the level to fill.
+ *  @returns  true if the index is valid
+ */
+tBool
+difficultyGetEntry(tU8 index, DifficultyLevel *level)
+{
+    if (index >= DIFFICULTY_ENTRIES) return FALSE;
+    if (curveValid == FALSE) difficultyReset();
+
+    *level = curve[index];
+    return TRUE;
+}
+
+/*!
+ *  @brief    A function for replacing an entry of the
+ *            curve, e.g. to tune it from the console.
+ *            Entries out of the sensible range are refused.
+ *  @param index
+ *            Index of the entry, 0 to DIFFICULTY_ENTRIES - 1.
+ *  @param level
+ *            A pointer to the new entry.
+ *  @returns  true if the entry has been replaced
+ */
+tBool
+difficultySetEntry(tU8 index, const DifficultyLevel *level)
+{
+    if (index >= DIFFICULTY_ENTRIES) return FALSE;
+    if (level->obstacleDelayMs == 0 || level->spacingPercent == 0) return FALSE;
+    if (level->minSpeed == 0 || level->minSpeed > level->maxSpeed) return FALSE;
+    if (level->ballSpeed == 0) return FALSE;
+    if (curveValid == FALSE) difficultyReset();
+
+    curve[index] = *level;
+    return TRUE;
+}
@@ -0,0 +1,40 @@
+/******************************************************************************
+ *
+ * Copyright:
+ *    Byczki(TM)
+ *
+ * File:
+ *    difficulty.h
+ *
+ * Description:
+ *    Expose the difficulty curve of the game.
+ *
+ *****************************************************************************/
+#ifndef _DIFFICULTY_H_
+#define _DIFFICULTY_H_
+
+#include <general.h>
+
+#define DIFFICULTY_STEP_MS 10000
+#define DIFFICULTY_ENTRIES 8
+
+/*
+ * Difficulty at a point of the curve. Entries are DIFFICULTY_STEP_MS
+ * of game time apart, the last one holds for the rest of the game.
+ */
+typedef struct DifficultyLevel
+{
+    tU16 obstacleDelayMs;   /* period of obstacle moves */
+    tU8 spacingPercent;     /* row spacing of the waves, i.e. spawn rate */
+    tU8 minSpeed;           /* obstacle speed range, pixels per move */
+    tU8 maxSpeed;
+    tU8 ballSpeed;          /* pixels per ball move */
+    tU8 waveLevel;          /* hardest wave pattern allowed */
+} DifficultyLevel;
+
+void difficultyReset(void);
+void difficultyAt(tU32 gameMs, DifficultyLevel *level);
+tBool difficultyGetEntry(tU8 index, DifficultyLevel *level);
+tBool difficultySetEntry(tU8 index, const DifficultyLevel *level);
+
+#endif
@@ -0,0 +1,194 @@
+/******************************************************************************
+ *
+ * Copyright:
+ *    Byczki(TM)
+ *
+ * File:
+ *    eventflags.c
+ *
+ * Description:
+ *    Implement event-flag groups, a word of flags that processes can
+ *    wait on for any or all of a set of bits. Every waiter blocks on
+ *    a semaphore of its own slot, so the OS keeps it in the priority
+ *    ordered wait list of that semaphore and handles the timeout. The
+ *    setter checks the waiters against the new flags and wakes only
+ *    those whose condition holds.
+ *
+ *    Flags may be set and cleared from an ISR; waiting must be done
+ *    by a process.
+ *
+ *****************************************************************************/
+
+#include "pre_emptive_os/api/osapi.h"
+#include "pre_emptive_os/core/_oshal/api/a7hal.h"
+#include "./eventflags.h"
+
+/*!
+ *  @brief    A function checking the flags against
+ *            the condition of a wait.
+ *  @param flags
+ *            Current flags of the group.
+ *  @param mask
+ *            Flags waited for.
+ *  @param mode
+ *            EVENT_FLAGS_ANY or EVENT_FLAGS_ALL.
+ *  @returns  the flags satisfying the wait, zero if
+ *            it is not satisfied
+ */
+static tU32
+satisfied(tU32 flags, tU32 mask, tU8 mode)
+{
+    tU32 set = flags & mask;
+
+    if (mode & EVENT_FLAGS_ALL) return set == mask ? set : 0;
+    return set;
+}
+
+/*!
+ *  @brief    A procedure for initializing a group with
+ *            all the flags cleared and no waiters.
+ *  @param group
+ *            A pointer to the group to initialize.
+ */
+void
+eventFlagsInit(EventFlags *group)
+{
+    tU8 i;
+
+    group->flags = 0;
+    for (i = 0; i < EVENT_FLAGS_WAITERS; i++)
+    {
+        osSemInit(&group->waiters[i].wake, 0);
+        group->waiters[i].waiting = FALSE;
+        group->waiters[i].used = FALSE;
+    }
+}
+
+/*!
+ *  @brief    A procedure for setting flags and waking
+ *            all the waiters whose condition now holds.
+ *  @param group
+ *            A pointer to an initialized group.
+ *  @param bits
+ *            Flags to set.
+ */
+void
+eventFlagsSet(EventFlags *group, tU32 bits)
+{
+    volatile tSR localSR;
+    tU32 consumed = 0;
+    tU8 error;
+    tU8 i;
+
+    m_os_dis_int();
+    group->flags |= bits;
+    for (i = 0; i < EVENT_FLAGS_WAITERS; i++)
+    {
+        EventFlagsWaiter *waiter = &group->waiters[i];
+        tU32 result;
+
+        if (waiter->waiting == FALSE) continue;
+        result = satisfied(group->flags, waiter->mask, waiter->mode);
+        if (result == 0) continue;
+
+        waiter->result = result;
+        waiter->waiting = FALSE;
+        if (waiter->mode & EVENT_FLAGS_CLEAR) consumed |= result;
+        osSemGive(&waiter->wake, &error);
+    }
+    group->flags &= ~consumed;
+    m_os_ena_int();
+}
+
+/*!
+ *  @brief    A procedure for clearing flags.
+ *  @param group
+ *            A pointer to an initialized group.
+ *  @param bits
+ *            Flags to clear.
+ */
+void
+eventFlagsClear(EventFlags *group, tU32 bits)
+{
+    volatile tSR localSR;
+
+    m_os_dis_int();
+    group->flags &= ~bits;
+    m_os_ena_int();
+}
+
+/*!
+ *  @brief    A function for reading the flags.
+ *  @param group
+ *            A pointer to an initialized group.
+ *  @returns  current flags of the group
+ */
+tU32
+eventFlagsGet(EventFlags *group)
+{
+    return group->flags;
+}
+
+/*!
+ *  @brief    A function blocking the calling process
+ *            until any or all of the given flags are set.
+ *  @param group
+ *            A pointer to an initialized group.
+ *  @param mask
+ *            Flags to wait for.
+ *  @param mode
+ *            EVENT_FLAGS_ANY or EVENT_FLAGS_ALL, with
+ *            EVENT_FLAGS_CLEAR to clear the flags that
+ *            satisfied the wait.
+ *  @param timeout
+ *            Number of ticks to wait, zero means wait
+ *            forever.
+ *  @returns  the flags that satisfied the wait, zero
+ *            on timeout or if all the waiter slots
+ *            are taken
+ */
+tU32
+eventFlagsWait(EventFlags *group, tU32 mask, tU8 mode, tU32 timeout)
+{
+    volatile tSR localSR;
+    EventFlagsWaiter *waiter = NULL;
+    tU32 result;
+    tU8 error;
+    tU8 i;
+
+    m_os_dis_int();
+    result = satisfied(group->flags, mask, mode);
+    if (result != 0)
+    {
+        if (mode & EVENT_FLAGS_CLEAR) group->flags &= ~result;
+        m_os_ena_int();
+        return result;
+    }
+
+    for (i = 0; i < EVENT_FLAGS_WAITERS && waiter == NULL; i++)
+    {
+        if (group->waiters[i].used == FALSE) waiter = &group->waiters[i];
+    }
+    if (waiter == NULL)
+    {
+        m_os_ena_int();
+        return 0;
+    }
+    waiter->mask = mask;
+    waiter->mode = mode;
+    waiter->result = 0;
+    waiter->waiting = TRUE;
+    waiter->used = TRUE;
+    m_os_ena_int();
+
+    osSemTake(&waiter->wake, timeout, &error);
+
+    // the flags may have been set between the timeout and here
+    m_os_dis_int();
+    result = waiter->result;
+    waiter->waiting = FALSE;
+    waiter->used = FALSE;
+    if (waiter->wake.cnt > 0) osSemTryTake(&waiter->wake, &error);
+    m_os_ena_int();
+    return result;
+}
@@ -0,0 +1,53 @@
+/******************************************************************************
+ *
+ * Copyright:
+ *    Byczki(TM)
+ *
+ * File:
+ *    eventflags.h
+ *
+ * Description:
+ *    Expose public functions and types of the event-flag groups.
+ *
+ *****************************************************************************/
+#ifndef _EVENTFLAGS_H_
+#define _EVENTFLAGS_H_
+
+#include "pre_emptive_os/api/osapi.h"
+#include <general.h>
+
+#define EVENT_FLAGS_WAITERS 4
+
+// wait modes, EVENT_FLAGS_CLEAR may be or-ed to either
+#define EVENT_FLAGS_ANY 0x00
+#define EVENT_FLAGS_ALL 0x01
+#define EVENT_FLAGS_CLEAR 0x02
+
+/*
+ * A slot of a process blocked on a group. The setter fills result
+ * with the flags that satisfied the wait and clears waiting before
+ * waking the process, which frees the slot once it has run.
+ */
+typedef struct EventFlagsWaiter
+{
+    tCntSem wake;
+    tU32 mask;
+    tU32 result;
+    tU8 mode;
+    tBool waiting;
+    tBool used;
+} EventFlagsWaiter;
+
+typedef struct EventFlags
+{
+    volatile tU32 flags;
+    EventFlagsWaiter waiters[EVENT_FLAGS_WAITERS];
+} EventFlags;
+
+void eventFlagsInit(EventFlags *group);
+void eventFlagsSet(EventFlags *group, tU32 bits);
+void eventFlagsClear(EventFlags *group, tU32 bits);
+tU32 eventFlagsGet(EventFlags *group);
+tU32 eventFlagsWait(EventFlags *group, tU32 mask, tU8 mode, tU32 timeout);
+
+#endif
@@ -0,0 +1,37 @@
+/******************************************************************************
+ *
+ * Copyright:
+ *    Byczki(TM)
+ *
+ * File:
+ *    fastcode.h
+ *
+ * Description:
+ *    Tag for hot functions run from SRAM instead of flash. Tagged
+ *    functions go to the .fastcode section, which every linker script
+ *    in build_files places in the initialized data and the startup
+ *    code copies to RAM. The tagged functions are kept in their own
+ *    sources (lcd_fast.c, adc_fast.c, irq_fast.c), which FAST_CSRCS
+ *    in the makefile compiles as ARM code with FAST_OFLAGS. Everything
+ *    else stays Thumb.
+ *
+ *    Flash and RAM are too far apart for a BL, so the tag also makes
+ *    callers use long calls. It must be on the prototype seen by the
+ *    callers, not only on the definition.
+ *
+ *    Defining NO_FASTCODE (NO_FASTCODE=1 on the make command line)
+ *    turns the tag off and leaves every function in flash. The gain
+ *    is measured on target by comparing the "bench" console output of
+ *    a default build with one made with NO_FASTCODE=1 FAST_CSRCS=.
+ *
+ *****************************************************************************/
+#ifndef _FASTCODE_H_
+#define _FASTCODE_H_
+
+#if defined(__arm__) && !defined(NO_FASTCODE)
+#define FASTCODE __attribute__((section(".fastcode"), long_call))
+#else
+#define FASTCODE
+#endif
+
+#endif
@@ -4,6 +4,7 @@
 
 #include <general.h>
 #include "i2c.h"
+#include "mutex.h"
 #include <lpc2xxx.h>
 
 /******************************************************************************
@@ -30,6 +31,10 @@
 #define I2C_REG_SCLL        0x00000100 /* SCL Duty Cycle low register  */
 #define I2C_REG_SCLL_MASK   0x0000FFFF /* Used bits                    */
 
+#define I2C_LOCK_CEILING    2 /* the game workers, see GAME_WORKER_PRIO */
+
+static Mutex i2cMutex;
+
 /******************************************************************************
  *
  * Description:
@@ -105,6 +110,34 @@ i2cInit(void)
   I2C_SCLH   = ( I2C_SCLH   & ~I2C_REG_SCLH_MASK )   | I2C_REG_SCLH;
   I2C_ADDR   = ( I2C_ADDR   & ~I2C_REG_ADDR_MASK )   | I2C_REG_ADDR;
   I2C_CONSET = ( I2C_CONSET & ~I2C_REG_CONSET_MASK ) | I2C_REG_CONSET;
+
+  mutexInit(&i2cMutex, "i2c", I2C_LOCK_CEILING);
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Lock the bus for the calling process. Must be held over a whole
+ *    transaction, or over several that have to follow each other.
+ *    Calls may nest and each must be matched by i2cUnlock().
+ *
+ *****************************************************************************/
+void
+i2cLock(void)
+{
+  mutexLock(&i2cMutex, 0);
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Unlock the bus locked with i2cLock().
+ *
+ *****************************************************************************/
+void
+i2cUnlock(void)
+{
+  mutexUnlock(&i2cMutex);
 }
 
 /******************************************************************************
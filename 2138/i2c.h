@@ -89,6 +89,8 @@
 
 tU8  i2cCheckStatus(void);
 void i2cInit(void);
+void i2cLock(void);
+void i2cUnlock(void);
 tS8  i2cStart(void);
 tS8  i2cRepeatStart(void);
 tS8  i2cStop(void);
@@ -0,0 +1,235 @@
+/******************************************************************************
+ *
+ * Copyright:
+ *    Byczki(TM)
+ *
+ * File:
+ *    irq.c
+ *
+ * Description:
+ *    Implement registration of interrupt handlers in the vector slots
+ *    of the VIC. The priority of a source is the number of its slot.
+ *    Every slot has its own entry function, which times the handler
+ *    with the cycle counter and keeps per-source statistics. The
+ *    entries run from RAM and are in irq_fast.c.
+ *
+ *    Interrupts still enter through the common IRQ handler of the OS
+ *    (IRQ_HANDLER 0 in config.h), which reads the vector address from
+ *    the VIC. The OS needs this path to save the process context and
+ *    to switch processes on ISR exit, so a direct LDR PC,[PC,#-0xFF0]
+ *    entry would break osSemGive and the tick in any handler.
+ *
+ *****************************************************************************/
+
+#include "pre_emptive_os/api/osapi.h"
+#include "pre_emptive_os/core/_oshal/api/a7hal.h"
+#include <printf_P.h>
+#include <lpc2xxx.h>
+#include "./systime.h"
+#include "./irq.h"
+#include "./irq_slot.h"
+
+#define VECT_ADDR(slot) ((volatile unsigned long *)&VICVectAddr0)[slot]
+#define VECT_CNTL(slot) ((volatile unsigned long *)&VICVectCntl0)[slot]
+#define VECT_ENABLE 0x20
+#define NO_SLOT 0xff
+#define PROBE_TIMEOUT_US 1000
+
+IrqSlot irqSlots[IRQ_SLOTS];
+volatile tU32 irqProbeStart;
+volatile tBool irqProbeDone;
+
+static tU8 slotOfSource[IRQ_SOURCES];
+static tBool slotsInitialized = FALSE;
+
+/*!
+ *  @brief    A procedure for clearing the statistics
+ *            of a slot.
+ *  @param stats
+ *            A pointer to the statistics to clear.
+ */
+static void
+resetStats(IrqStats *stats)
+{
+    stats->count = 0;
+    stats->totalCycles = 0;
+    stats->maxCycles = 0;
+    stats->probes = 0;
+    stats->minLatencyCycles = 0xffffffff;
+    stats->maxLatencyCycles = 0;
+}
+
+/*!
+ *  @brief    A procedure marking all the sources
+ *            as unregistered, on first use.
+ */
+static void
+initSlots(void)
+{
+    tU8 i;
+
+    if (slotsInitialized) return;
+    for (i = 0; i < IRQ_SOURCES; i++)
+        slotOfSource[i] = NO_SLOT;
+    slotsInitialized = TRUE;
+}
+
+/*!
+ *  @brief    A function for registering an interrupt
+ *            handler in a vector slot of the VIC and
+ *            enabling its source. The handler must clear
+ *            the interrupt flag of its peripheral, the VIC
+ *            is acknowledged by the slot entry.
+ *  @param source
+ *            VIC channel of the source, see IRQ_SOURCE_*.
+ *  @param handler
+ *            A function to be called on the interrupt.
+ *  @param priority
+ *            Vector slot to use, 0 (highest) to 15.
+ *  @returns  true if the handler has been registered,
+ *            false if the slot is taken (e.g. by the OS
+ *            tick) or the source already has a handler
+ */
+tBool
+irqRegister(tU8 source, void (*handler)(void), tU8 priority)
+{
+    volatile tSR localSR;
+    tBool registered = FALSE;
+
+    if (source >= IRQ_SOURCES || priority >= IRQ_SLOTS || handler == NULL) return FALSE;
+
+    m_os_dis_int();
+    initSlots();
+    if ((VECT_CNTL(priority) & VECT_ENABLE) == 0 &&
+        (VICIntEnable & (1ul << source)) == 0)
+    {
+        irqSlots[priority].handler = handler;
+        irqSlots[priority].source = source;
+        resetStats(&irqSlots[priority].stats);
+        slotOfSource[source] = priority;
+
+        VICIntSelect &= ~(1ul << source);
+        VECT_ADDR(priority) = (unsigned long)irqSlotEntries[priority];
+        VECT_CNTL(priority) = VECT_ENABLE | source;
+        VICIntEnable = 1ul << source;
+        registered = TRUE;
+    }
+    m_os_ena_int();
+
+    return registered;
+}
+
+/*!
+ *  @brief    A procedure for disabling a source and
+ *            freeing its vector slot.
+ *  @param source
+ *            VIC channel of the source.
+ */
+void
+irqUnregister(tU8 source)
+{
+    volatile tSR localSR;
+    tU8 slot;
+
+    if (source >= IRQ_SOURCES) return;
+
+    m_os_dis_int();
+    initSlots();
+    slot = slotOfSource[source];
+    if (slot != NO_SLOT)
+    {
+        VICIntEnClr = 1ul << source;
+        VECT_CNTL(slot) = 0;
+        VECT_ADDR(slot) = 0;
+        irqSlots[slot].handler = NULL;
+        slotOfSource[source] = NO_SLOT;
+    }
+    m_os_ena_int();
+}
+
+/*!
+ *  @brief    A function for measuring the entry latency
+ *            of a registered source once. The interrupt
+ *            is raised in software and the time until its
+ *            slot entry runs is recorded, including the OS
+ *            IRQ entry and any higher-priority handler
+ *            running at that moment.
+ *  @param source
+ *            VIC channel of the source.
+ *  @returns  true if the probe has completed
+ */
+tBool
+irqProbe(tU8 source)
+{
+    tU32 timeout;
+
+    if (source >= IRQ_SOURCES) return FALSE;
+    initSlots();
+    if (slotOfSource[source] == NO_SLOT) return FALSE;
+
+    irqProbeDone = FALSE;
+    irqProbeStart = timeCycles();
+    VICSoftInt = 1ul << source;
+
+    timeout = timeNowUs() + PROBE_TIMEOUT_US;
+    while (irqProbeDone == FALSE)
+    {
+        if ((tS32)(timeNowUs() - timeout) > 0)
+        {
+            VICSoftIntClr = 1ul << source;
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/*!
+ *  @brief    A function for reading the statistics
+ *            of a source.
+ *  @param source
+ *            VIC channel of the source.
+ *  @param stats
+ *            Returns a copy of the statistics.
+ *  @returns  true if the source is registered
+ */
+tBool
+irqGetStats(tU8 source, IrqStats *stats)
+{
+    volatile tSR localSR;
+    tU8 slot;
+
+    if (source >= IRQ_SOURCES) return FALSE;
+    initSlots();
+    slot = slotOfSource[source];
+    if (slot == NO_SLOT) return FALSE;
+
+    m_os_dis_int();
+    *stats = irqSlots[slot].stats;
+    m_os_ena_int();
+    return TRUE;
+}
+
+/*!
+ *  @brief    A procedure printing the statistics of
+ *            all the registered sources. Times are given
+ *            in cycles of the peripheral clock, as entry
+ *            latencies are usually below a microsecond.
+ */
+void
+irqReport(void)
+{
+    tU8 slot;
+
+    printf("slot  source  count  avg  max  latency (cycles)\n");
+    for (slot = 0; slot < IRQ_SLOTS; slot++)
+    {
+        IrqStats stats;
+
+        if (irqSlots[slot].handler == NULL) continue;
+        irqGetStats(irqSlots[slot].source, &stats);
+        printf("%d  %d  %u  %u  %u  ", slot, irqSlots[slot].source, stats.count,
+               stats.count ? stats.totalCycles / stats.count : 0, stats.maxCycles);
+        if (stats.probes) printf("%u-%u\n", stats.minLatencyCycles, stats.maxLatencyCycles);
+        else printf("-\n");
+    }
+}
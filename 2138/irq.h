@@ -0,0 +1,64 @@
+/******************************************************************************
+ *
+ * Copyright:
+ *    Byczki(TM)
+ *
+ * File:
+ *    irq.h
+ *
+ * Description:
+ *    Expose public functions and defines of the vectored interrupts.
+ *
+ *****************************************************************************/
+#ifndef _IRQ_H_
+#define _IRQ_H_
+
+#include <general.h>
+
+/* VIC channels of the LPC2138 interrupt sources */
+#define IRQ_SOURCE_WDT    0
+#define IRQ_SOURCE_TIMER0 4
+#define IRQ_SOURCE_TIMER1 5
+#define IRQ_SOURCE_UART0  6
+#define IRQ_SOURCE_UART1  7
+#define IRQ_SOURCE_PWM0   8
+#define IRQ_SOURCE_I2C0   9
+#define IRQ_SOURCE_SPI0   10
+#define IRQ_SOURCE_SPI1   11
+#define IRQ_SOURCE_PLL    12
+#define IRQ_SOURCE_RTC    13
+#define IRQ_SOURCE_EINT0  14
+#define IRQ_SOURCE_EINT1  15
+#define IRQ_SOURCE_EINT2  16
+#define IRQ_SOURCE_EINT3  17
+#define IRQ_SOURCE_AD0    18
+#define IRQ_SOURCE_I2C1   19
+#define IRQ_SOURCE_BOD    20
+#define IRQ_SOURCE_AD1    21
+#define IRQ_SOURCES       32
+
+/* vector slots of the VIC, slot 0 has the highest priority */
+#define IRQ_SLOTS 16
+
+/*
+ * Measurements of a single interrupt source. Durations cover the
+ * registered handler, latencies are measured with irqProbe from
+ * the software trigger to the entry of the vector slot.
+ */
+typedef struct IrqStats
+{
+    tU32 count;
+    tU32 totalCycles;
+    tU32 maxCycles;
+    tU32 probes;
+    tU32 minLatencyCycles;
+    tU32 maxLatencyCycles;
+} IrqStats;
+
+tBool irqRegister(tU8 source, void (*handler)(void), tU8 priority);
+void irqUnregister(tU8 source);
+tBool irqProbe(tU8 source);
+tBool irqGetStats(tU8 source, IrqStats *stats);
+void irqReport(void);
+
+#endif
@@ -0,0 +1,73 @@
+/******************************************************************************
+ *
+ * Copyright:
+ *    Byczki(TM)
+ *
+ * File:
+ *    irq_fast.c
+ *
+ * Description:
+ *    Implement the entry functions of the VIC vector slots, which run
+ *    from RAM as ARM code, see fastcode.h. Only this file is listed in
+ *    FAST_CSRCS, the registration and the report in irq.c stay Thumb
+ *    code in flash.
+ *
+ *****************************************************************************/
+
+#include <general.h>
+#include <lpc2xxx.h>
+#include "./systime.h"
+#include "./fastcode.h"
+#include "./irq_slot.h"
+
+/*!
+ *  @brief    A procedure for running the handler of
+ *            a vector slot and recording its duration.
+ *            A software-triggered entry is a latency probe
+ *            and does not run the handler.
+ *  @param slot
+ *            Number of the vector slot.
+ */
+FASTCODE static void
+runSlot(tU8 slot)
+{
+    tU32 entry = timeCycles();
+    IrqSlot *irq = &irqSlots[slot];
+    tU32 bit = 1ul << irq->source;
+    tU32 cycles;
+
+    if (VICSoftInt & bit)
+    {
+        VICSoftIntClr = bit;
+        cycles = entry - irqProbeStart;
+        if (cycles < irq->stats.minLatencyCycles) irq->stats.minLatencyCycles = cycles;
+        if (cycles > irq->stats.maxLatencyCycles) irq->stats.maxLatencyCycles = cycles;
+        irq->stats.probes++;
+        irqProbeDone = TRUE;
+    }
+    else
+    {
+        irq->handler();
+        cycles = timeCycles() - entry;
+        irq->stats.count++;
+        irq->stats.totalCycles += cycles;
+        if (cycles > irq->stats.maxCycles) irq->stats.maxCycles = cycles;
+    }
+
+    VICVectAddr = 0;
+}
+
+#define SLOT_ENTRY(n) FASTCODE static void slotEntry##n(void) { runSlot(n); }
+SLOT_ENTRY(0)  SLOT_ENTRY(1)  SLOT_ENTRY(2)  SLOT_ENTRY(3)
+SLOT_ENTRY(4)  SLOT_ENTRY(5)  SLOT_ENTRY(6)  SLOT_ENTRY(7)
+SLOT_ENTRY(8)  SLOT_ENTRY(9)  SLOT_ENTRY(10) SLOT_ENTRY(11)
+SLOT_ENTRY(12) SLOT_ENTRY(13) SLOT_ENTRY(14) SLOT_ENTRY(15)
+#undef SLOT_ENTRY
+
+void (* const irqSlotEntries[IRQ_SLOTS])(void) =
+{
+    slotEntry0,  slotEntry1,  slotEntry2,  slotEntry3,
+    slotEntry4,  slotEntry5,  slotEntry6,  slotEntry7,
+    slotEntry8,  slotEntry9,  slotEntry10, slotEntry11,
+    slotEntry12, slotEntry13, slotEntry14, slotEntry15
+};
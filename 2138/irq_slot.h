@@ -0,0 +1,32 @@
+/******************************************************************************
+ *
+ * Copyright:
+ *    Byczki(TM)
+ *
+ * File:
+ *    irq_slot.h
+ *
+ * Description:
+ *    Expose the vector slot state shared by irq.c and the slot
+ *    entries in irq_fast.c. Not for use outside the two.
+ *
+ *****************************************************************************/
+#ifndef _IRQ_SLOT_H_
+#define _IRQ_SLOT_H_
+
+#include <general.h>
+#include "./irq.h"
+
+typedef struct IrqSlot
+{
+    void (*handler)(void);
+    tU8 source;
+    IrqStats stats;
+} IrqSlot;
+
+extern IrqSlot irqSlots[IRQ_SLOTS];
+extern volatile tU32 irqProbeStart;
+extern volatile tBool irqProbeDone;
+extern void (* const irqSlotEntries[IRQ_SLOTS])(void);
+
+#endif
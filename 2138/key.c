@@ -18,14 +18,17 @@
 #include "../pre_emptive_os/api/general.h"
 #include <printf_P.h>
 #include "key.h"
+#include "stackmon.h"
 #include <lpc2xxx.h>
+#include "systime.h"
+#include "ring.h"
 
 
 /******************************************************************************
  * Typedefs and defines
  *****************************************************************************/
-#define FIRST_REPEAT  4
-#define SECOND_REPEAT 3
+#define DEFAULT_FIRST_REPEAT_MS 200
+#define DEFAULT_REPEAT_MS       150
 
 #define KEYPROC_STACK_SIZE 300
 
@@ -34,6 +37,13 @@
 #define KEYPIN_DOWN   0x00001000
 #define KEYPIN_LEFT   0x00000200 
 #define KEYPIN_RIGHT  0x00000800
+#define KEYPIN_ALL    (KEYPIN_CENTER | KEYPIN_UP | KEYPIN_DOWN | KEYPIN_LEFT | KEYPIN_RIGHT)
+#define KEYPIN_SHIFT  8
+
+#define KEY_QUEUE_SIZE 8 /* a power of two, see ringInit */
+#define KEY_TIME_MASK  0x00ffffff
+
+#define KEY_SAMPLE_TICKS 1
 
 #if 0
       //check if P0.8 center-key is pressed
@@ -55,23 +65,35 @@
 /*****************************************************************************
  * Local variables
  ****************************************************************************/
-static tU8 centerReleased = TRUE;
-static tU8 keyUpReleased = TRUE;
-static tU8 keyDownReleased = TRUE;
-static tU8 keyLeftReleased = TRUE;
-static tU8 keyRightReleased = TRUE;
-static tU8 centerKeyCnt;
-static tU8 upKeyCnt;
-static tU8 downKeyCnt;
-static tU8 leftKeyCnt;
-static tU8 rightKeyCnt;
-
-static volatile tU8 activeKey = KEY_NOTHING;
+/* key bits for the five joystick pins P0.8-P0.12 (low = pressed) */
+static const tU8 pinsToKeys[32] =
+{
+  0x00, 0x10, 0x08, 0x18, 0x01, 0x11, 0x09, 0x19,
+  0x02, 0x12, 0x0a, 0x1a, 0x03, 0x13, 0x0b, 0x1b,
+  0x04, 0x14, 0x0c, 0x1c, 0x05, 0x15, 0x0d, 0x1d,
+  0x06, 0x16, 0x0e, 0x1e, 0x07, 0x17, 0x0f, 0x1f
+};
+
+/* two-bit vertical counters, one bit per key in each byte */
+static tU8 keyCnt0 = 0xff;
+static tU8 keyCnt1 = 0xff;
+static tU8 lastSample = KEY_NOTHING;
+
 static volatile tU8 activeKey2 = KEY_NOTHING;
 
+static volatile tU16 firstRepeatMs = DEFAULT_FIRST_REPEAT_MS;
+static volatile tU16 repeatMs = DEFAULT_REPEAT_MS;
+static tU32 nextRepeatMs;
+
+static RingChannel keyQueue;
+static RING_STORAGE(keyQueueArea, KEY_QUEUE_SIZE, sizeof(tU32));
+
 static tU8 keyProcStack[KEYPROC_STACK_SIZE];
 static tU8 keyProcPid;
 
+static tCntSem keyPressSem;
+static volatile tBool keyWaiting = FALSE;
+
 
 
 /*****************************************************************************
@@ -83,35 +105,133 @@ static tU8 keyProcPid;
 tU8
 getKeys(void)
 {
-  tU8 readKeys = KEY_NOTHING;
+  return pinsToKeys[(~IOPIN & KEYPIN_ALL) >> KEYPIN_SHIFT];
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Post a key event to the key queue. The event is packed into the queue
+ *    message itself: key in bits 0-4, kind in bit 5 and the low 24 bits of
+ *    the millisecond timestamp in bits 8-31. The key is never zero, so
+ *    neither is the message. Events are counted and dropped when the queue
+ *    is full. The queue is a ring buffer, so posting never masks
+ *    interrupts.
+ *
+ * Params:
+ *    [in] key  - The key (KEY_UP, KEY_DOWN, ...).
+ *    [in] kind - KEY_EVENT_PRESS or KEY_EVENT_REPEAT.
+ *
+ ****************************************************************************/
+static void
+postKeyEvent(tU8 key, tU8 kind)
+{
+  tU32 msg = key | (kind << 5) | ((timeNowMs() & KEY_TIME_MASK) << 8);
+
+  ringChannelPush(&keyQueue, &msg);
+}
 
-  if ((IOPIN & KEYPIN_CENTER) == 0) readKeys |= KEY_CENTER;
-  else if ((IOPIN & KEYPIN_UP) == 0)     readKeys |= KEY_UP;
-  else if ((IOPIN & KEYPIN_DOWN) == 0)   readKeys |= KEY_DOWN;
-  else if ((IOPIN & KEYPIN_LEFT) == 0)   readKeys |= KEY_LEFT;
-  else if ((IOPIN & KEYPIN_RIGHT) == 0)  readKeys |= KEY_RIGHT;
+/*****************************************************************************
+ *
+ * Description:
+ *    Unpack a message taken from the key queue.
+ *
+ * Params:
+ *    [in]  packed - The message.
+ *    [out] pEvent - The unpacked event.
+ *
+ ****************************************************************************/
+static void
+unpackKeyEvent(tU32 packed, tKeyEvent *pEvent)
+{
+  tU32 now = timeNowMs();
 
-  return readKeys;
+  pEvent->key = packed & 0x1f;
+  pEvent->kind = (packed >> 5) & 0x01;
+  //the event lies in the past, within the 24-bit range of the timestamp
+  pEvent->timeMs = now - ((now - (packed >> 8)) & KEY_TIME_MASK);
 }
 
 /*****************************************************************************
  *
  * Description:
- *    Function to check if any key press has been detected
+ *    Wait for the next key event. Events are delivered in the order the
+ *    keys were pressed, so fast presses are not lost. Only one process
+ *    should consume key events.
+ *
+ * Params:
+ *    [out] pEvent  - The received event.
+ *    [in]  timeout - Number of ticks to wait, zero means wait forever.
+ *
+ * Returns:
+ *    TRUE if an event was received, FALSE on timeout.
+ *
+ ****************************************************************************/
+tBool
+waitKeyEvent(tKeyEvent *pEvent, tU16 timeout)
+{
+  tU32 msg;
+
+  if (ringChannelPop(&keyQueue, &msg, timeout) == FALSE)
+    return FALSE;
+
+  unpackKeyEvent(msg, pEvent);
+  return TRUE;
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Function to check if any key press has been detected. Takes the next
+ *    event from the key queue without blocking.
  *
  ****************************************************************************/
 tU8
 checkKey(void)
 {
-  tU8 retVal = activeKey;
-  activeKey = KEY_NOTHING;
-  return retVal;
+  tU32 msg;
+
+  if (ringChannelTryPop(&keyQueue, &msg) == FALSE)
+    return KEY_NOTHING;
+  return (tU8)(msg & 0x1f);
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Get the number of key events dropped because the queue was full.
+ *
+ ****************************************************************************/
+tU16
+getKeyEventsDropped(void)
+{
+  return (tU16)keyQueue.ring.dropped;
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Set the auto-repeat timing of held keys.
+ *
+ * Params:
+ *    [in] firstMs - Delay from a press to the first repeat, zero disables
+ *                   auto-repeat.
+ *    [in] everyMs - Period of the following repeats.
+ *
+ ****************************************************************************/
+void
+setKeyRepeat(tU16 firstMs,
+             tU16 everyMs)
+{
+  firstRepeatMs = firstMs;
+  repeatMs = everyMs;
 }
 
 /*****************************************************************************
  *
  * Description:
- *    Function to check current (instantaneous) key state
+ *    Function to check current (instantaneous) debounced key state. All
+ *    held keys are reported, so chords can be detected.
  *
  ****************************************************************************/
 tU8
@@ -123,174 +243,71 @@ checkKey2(void)
 /*****************************************************************************
  *
  * Description:
- *    Sample key states
+ *    Sample key states. All five keys are debounced at once with two-bit
+ *    vertical counters: a key changes its debounced state after four
+ *    consecutive samples that differ from it. Keys pressed within the same
+ *    sample are reported together in one press event. While keys are held
+ *    they are repeated together, the repeat restarts when the set of held
+ *    keys grows.
  *
  ****************************************************************************/
 void
 sampleKey(void)
 {
-  tBool nothing = TRUE;
-  tU8   readKeys;
-  
-  //get sample
-  readKeys = getKeys();
-  
-
-  //check center key
-  if (readKeys & KEY_CENTER)
-  {
-    nothing = FALSE;
-  	if (centerReleased == TRUE)
-  	{
-  		centerReleased = FALSE;
-  		centerKeyCnt = 0;
-  		activeKey = KEY_CENTER;
-  		activeKey2 = KEY_CENTER;
-  	}
-  	else
-  	{
-  	  centerKeyCnt++;
-  	  if (centerKeyCnt == FIRST_REPEAT)
-  	  {
-  		  activeKey = KEY_CENTER;
-  		  activeKey2 = KEY_CENTER;
-  	  }
-  	  else if (centerKeyCnt >= FIRST_REPEAT + SECOND_REPEAT)
-  	  {
-  		  centerKeyCnt = FIRST_REPEAT;
-  		  activeKey = KEY_CENTER;
-  		  activeKey2 = KEY_CENTER;
-  	  }
-  	}
-  }
-  else
-  	centerReleased = TRUE;
+  tU8  changed;
+  tU8  pressed;
+  tU32 now = timeNowMs();
 
-  //check up key
-  if (readKeys & KEY_UP)
-  {
-    nothing = FALSE;
-  	if (keyUpReleased == TRUE)
-  	{
-  		keyUpReleased = FALSE;
-  		upKeyCnt = 0;
-  		activeKey = KEY_UP;
-  		activeKey2 = KEY_UP;
-  	}
-  	else
-  	{
-  	  upKeyCnt++;
-  	  if (upKeyCnt == FIRST_REPEAT)
-  	  {
-  		  activeKey = KEY_UP;
-  		  activeKey2 = KEY_UP;
-  	  }
-  	  else if (upKeyCnt >= FIRST_REPEAT + SECOND_REPEAT)
-  	  {
-  		  upKeyCnt = FIRST_REPEAT;
-  		  activeKey = KEY_UP;
-  		  activeKey2 = KEY_UP;
-  	  }
-  	}
-  }
-  else
-  	keyUpReleased = TRUE;
+  lastSample = getKeys();
+
+  //count samples that differ from the debounced state, reset the others
+  changed = activeKey2 ^ lastSample;
+  keyCnt0 = ~(keyCnt0 & changed);
+  keyCnt1 = keyCnt0 ^ (keyCnt1 & changed);
+  changed &= keyCnt0 & keyCnt1;
 
-  //check down key
-  if (readKeys & KEY_DOWN)
+  activeKey2 ^= changed;
+  pressed = activeKey2 & changed;
+
+  if (pressed != KEY_NOTHING)
   {
-    nothing = FALSE;
-  	if (keyDownReleased == TRUE)
-  	{
-  		keyDownReleased = FALSE;
-  		downKeyCnt = 0;
-  		activeKey = KEY_DOWN;
-  		activeKey2 = KEY_DOWN;
-  	}
-  	else
-  	{
-  	  downKeyCnt++;
-  	  if (downKeyCnt == FIRST_REPEAT)
-  	  {
-  		  activeKey = KEY_DOWN;
-  		  activeKey2 = KEY_DOWN;
-  	  }
-  	  else if (downKeyCnt >= FIRST_REPEAT + SECOND_REPEAT)
-  	  {
-  		  downKeyCnt = FIRST_REPEAT;
-  		  activeKey = KEY_DOWN;
-  		  activeKey2 = KEY_DOWN;
-  	  }
-  	}
+    postKeyEvent(pressed, KEY_EVENT_PRESS);
+    nextRepeatMs = now + firstRepeatMs;
   }
-  else
-  	keyDownReleased = TRUE;
-
-  //check left key
-  if (readKeys & KEY_LEFT)
+  else if (activeKey2 != KEY_NOTHING && firstRepeatMs != 0 &&
+           (tS32)(now - nextRepeatMs) >= 0)
   {
-    nothing = FALSE;
-  	if (keyLeftReleased == TRUE)
-  	{
-  		keyLeftReleased = FALSE;
-  		leftKeyCnt = 0;
-  		activeKey = KEY_LEFT;
-  		activeKey2 = KEY_LEFT;
-  	}
-  	else
-  	{
-  	  leftKeyCnt++;
-  	  if (leftKeyCnt == FIRST_REPEAT)
-  	  {
-  		  activeKey = KEY_LEFT;
-  		  activeKey2 = KEY_LEFT;
-  	  }
-  	  else if (leftKeyCnt >= FIRST_REPEAT + SECOND_REPEAT)
-  	  {
-  		  leftKeyCnt = FIRST_REPEAT;
-  		  activeKey = KEY_LEFT;
-  		  activeKey2 = KEY_LEFT;
-  	  }
-  	}
+    postKeyEvent(activeKey2, KEY_EVENT_REPEAT);
+    nextRepeatMs += repeatMs;
   }
-  else
-  	keyLeftReleased = TRUE;
+}
+
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Detect a key being touched while the key process is waiting for one.
+ *    Called every OS tick from appTick, i.e., in interrupt context. Only
+ *    P0.9 of the joystick pins can be routed to an external interrupt, so
+ *    the edge is detected on the tick instead; when no key is touched this
+ *    costs a single IOPIN read.
+ *
+ ****************************************************************************/
+void
+keyTick(void)
+{
+  tU8 error;
 
-  //check right key
-  if (readKeys & KEY_RIGHT)
+  if (keyWaiting == FALSE)
+    return;
+
+  if ((IOPIN & KEYPIN_ALL) != KEYPIN_ALL)
   {
-    nothing = FALSE;
-  	if (keyRightReleased == TRUE)
-  	{
-  		keyRightReleased = FALSE;
-  		rightKeyCnt = 0;
-  		activeKey = KEY_RIGHT;
-  		activeKey2 = KEY_RIGHT;
-  	}
-  	else
-  	{
-  	  rightKeyCnt++;
-  	  if (rightKeyCnt == FIRST_REPEAT)
-  	  {
-  		  activeKey = KEY_RIGHT;
-  		  activeKey2 = KEY_RIGHT;
-  	  }
-  	  else if (rightKeyCnt >= FIRST_REPEAT + SECOND_REPEAT)
-  	  {
-  		  rightKeyCnt = FIRST_REPEAT;
-  		  activeKey = KEY_RIGHT;
-  		  activeKey2 = KEY_RIGHT;
-  	  }
-  	}
+    keyWaiting = FALSE;
+    osSemGive(&keyPressSem, &error);
   }
-  else
-  	keyRightReleased = TRUE;
-  
-  if (nothing == TRUE)
-    activeKey2 = KEY_NOTHING;
 }
 
-
 /*****************************************************************************
  *
  * Description:
@@ -304,13 +321,22 @@ static void
 procKey(void* arg)
 {
   //make all key signals as inputs
-  IODIR &= ~(KEYPIN_CENTER | KEYPIN_UP | KEYPIN_DOWN | KEYPIN_LEFT | KEYPIN_RIGHT);
+  IODIR &= ~KEYPIN_ALL;
 
-  //sample keys each 50 ms, i.e., 20 times per second
+  //sample keys every tick while any key is touched or debouncing,
+  //otherwise sleep until keyTick detects a key being touched
   while(1)
   {
     sampleKey();
-    osSleep(5);
+    if (activeKey2 == KEY_NOTHING && lastSample == KEY_NOTHING)
+    {
+      tU8 error;
+
+      keyWaiting = TRUE;
+      osSemTake(&keyPressSem, 0, &error);
+    }
+    else
+      osSleep(KEY_SAMPLE_TICKS);
   }
 }
 
@@ -325,7 +351,10 @@ initKeyProc(void)
 {
   tU8 error;
 
+  osSemInit(&keyPressSem, 0);
+  ringChannelInit(&keyQueue, keyQueueArea, sizeof(tU32), KEY_QUEUE_SIZE);
   osCreateProcess(procKey, keyProcStack, KEYPROC_STACK_SIZE, &keyProcPid, 3, NULL, &error);
   osStartProcess(keyProcPid, &error);
+  stackMonAddProcess("key", keyProcPid, keyProcStack, KEYPROC_STACK_SIZE);
 }
 
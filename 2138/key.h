@@ -29,10 +29,24 @@
 #define KEY_LEFT    0x08
 #define KEY_CENTER  0x10
 
+#define KEY_EVENT_PRESS  0
+#define KEY_EVENT_REPEAT 1
+
+typedef struct
+{
+  tU8  key;     /* KEY_UP, KEY_DOWN, ... */
+  tU8  kind;    /* KEY_EVENT_PRESS or KEY_EVENT_REPEAT */
+  tU32 timeMs;  /* time of the event, see timeNowMs */
+} tKeyEvent;
+
 
 tU8 checkKey(void);
 tU8 checkKey2(void);
+void setKeyRepeat(tU16 firstMs, tU16 everyMs);
+tBool waitKeyEvent(tKeyEvent *pEvent, tU16 timeout);
+tU16 getKeyEventsDropped(void);
 
 void initKeyProc(void);
+void keyTick(void);
 
 #endif
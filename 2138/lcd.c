@@ -24,22 +24,6 @@
 /******************************************************************************
  * Typedefs and defines
  *****************************************************************************/
-#define LCD_CMD_SWRESET   0x01
-#define LCD_CMD_BSTRON    0x03
-#define LCD_CMD_SLEEPIN   0x10
-#define LCD_CMD_SLEEPOUT  0x11
-#define LCD_CMD_INVON     0x21
-#define LCD_CMD_SETCON    0x25
-#define LCD_CMD_DISPON    0x29
-#define LCD_CMD_CASET     0x2A
-#define LCD_CMD_PASET     0x2B
-#define LCD_CMD_RAMWR     0x2C
-#define LCD_CMD_RGBSET    0x2D
-#define LCD_CMD_MADCTL    0x36
-#define LCD_CMD_COLMOD    0x3A
-
-#define MADCTL_HORIZ      0x48
-#define MADCTL_VERT       0x68
 
 
 /*****************************************************************************
@@ -54,7 +38,6 @@ static tU8 setcolmark;
 /*****************************************************************************
  * Local prototypes
  ****************************************************************************/
-static void lcdWindow1(tU8 xp, tU8 yp, tU8 xe, tU8 ye);
 
 
 /*****************************************************************************
@@ -210,26 +193,32 @@ lcdContrast(tU8 cont) //vary between 0 - 127
 /*****************************************************************************
  *
  * Description:
- *    Draw a rectangular area with specified color.
+ *    Select the controller, open a window and start a memory write.
+ *    Pixels are then sent with lcdWrdata() in row order, and the
+ *    transfer must be finished with lcdEndWrite().
  *
  ****************************************************************************/
 void
-lcdRect(tU8 x, tU8 y, tU8 xLen, tU8 yLen, tU8 color)
+lcdStartWrite(tU8 x, tU8 y, tU8 xLen, tU8 yLen)
 {
-  tU32 i;
-  tU32 len;
-
   //select controller
-  selectLCD(TRUE);   
+  selectLCD(TRUE);
 
   lcdWindow1(x,y,x+xLen-1,y+yLen-1);
-  
+
   lcdWrcmd(LCD_CMD_RAMWR);    //write memory
-  
-  len = xLen*yLen;
-  for(i=0; i<len; i++)
-    lcdWrdata(color);
+}
 
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Finish a memory write started with lcdStartWrite().
+ *
+ ****************************************************************************/
+void
+lcdEndWrite(void)
+{
   //deselect controller
   selectLCD(FALSE);
 }
@@ -364,27 +353,6 @@ lcdWindow(tU8 xp, tU8 yp, tU8 xe, tU8 ye)
 }
 
 
-/*****************************************************************************
- *
- * Description:
- *    Initialize LCD controller for a window (to write in).
- *    Set start xy-position and xy-length
- *    No select/deselect of LCD controller.
- *
- ****************************************************************************/
-static void
-lcdWindow1(tU8 xp, tU8 yp, tU8 xe, tU8 ye)
-{
-  lcdWrcmd(LCD_CMD_CASET);    //set X
-  lcdWrdata(xp+2);
-	lcdWrdata(xe+2);
-
-	lcdWrcmd(LCD_CMD_PASET);    //set Y
-	lcdWrdata(yp+2);
-	lcdWrdata(ye+2);
-}
-
-
 /*****************************************************************************
  *
  * Description:
@@ -493,29 +461,4 @@ lcdPuts(char *s)
 }
 
 
-/*****************************************************************************
- *
- * Description:
- *    Send command data to LCD controller
- *
- ****************************************************************************/
-void
-lcdWrcmd(tU8 data)
-{
-  sendToLCD(0, data);
-}
-
-
-/*****************************************************************************
- *
- * Description:
- *    Send data byte to LCD controller
- *
- ****************************************************************************/
-void
-lcdWrdata(tU8 data)
-{
-  sendToLCD(1, data);
-}
-
 
@@ -13,6 +13,8 @@
 #ifndef _LCD_H_
 #define _LCD_H_
 
+#include "fastcode.h"
+
 #define WHITE (tU8)0xFFu
 #define BLACK (tU8)0x00u
 #define LCD_HEIGHT 128
@@ -27,11 +29,13 @@ void lcdPuts(char s[]);
 void lcdGotoxy(tU8 x, tU8 y);
 void lcdWindow(tU8 xp, tU8 yp, tU8 xe, tU8 ye);
 void lcdColor(tU8 bkg, tU8 text);
-void lcdRect(tU8 x, tU8 y, tU8 xLen, tU8 yLen, tU8 color);
+FASTCODE void lcdRect(tU8 x, tU8 y, tU8 xLen, tU8 yLen, tU8 color);
 void lcdRectBrd(tU8 x, tU8 y, tU8 xLen, tU8 yLen, tU8 color1, tU8 color2, tU8 color3);
+void lcdStartWrite(tU8 x, tU8 y, tU8 xLen, tU8 yLen);
+void lcdEndWrite(void);
 void lcdIcon(tU8 x, tU8 y, tU8 xLen, tU8 yLen, tU8 compressionOn, tU8 escapeChar, const tU8* pData);
 
-void lcdWrdata(tU8 data);
-void lcdWrcmd(tU8 cmd);
+FASTCODE void lcdWrdata(tU8 data);
+FASTCODE void lcdWrcmd(tU8 cmd);
 
 #endif
@@ -0,0 +1,140 @@
+/******************************************************************************
+ *
+ * Copyright:
+ *    (C) 2006 Embedded Artists AB
+ *
+ * File:
+ *    lcd_fast.c
+ *
+ * Description:
+ *    Implements the LCD transfer routines that run from RAM as ARM
+ *    code, see fastcode.h. Only this file is listed in FAST_CSRCS, the
+ *    rest of the LCD driver (lcd.c, lcd_hw.c) stays Thumb code in
+ *    flash.
+ *
+ *****************************************************************************/
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#include "../pre_emptive_os/api/general.h"
+#include "../pre_emptive_os/api/osapi.h"
+#include <lpc2xxx.h>
+#include "lcd.h"
+#include "lcd_hw.h"
+
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Send 9-bit data to LCD controller
+ *
+ ****************************************************************************/
+FASTCODE void
+sendToLCD(tU8 firstBit, tU8 data)
+{
+  //disable SPI
+  IOCLR = LCD_CLK;
+  PINSEL0 &= 0xffffc0ff;
+  
+  if (1 == firstBit)
+    IOSET = LCD_MOSI;   //set MOSI
+  else
+    IOCLR = LCD_MOSI;   //reset MOSI
+  
+  //Set clock high
+  IOSET = LCD_CLK;
+  
+  //Set clock low
+  IOCLR = LCD_CLK;
+  
+  /*
+   * Enable SPI again
+   */
+  //initialize SPI interface
+  SPI_SPCCR = 0x08;    
+  SPI_SPCR  = 0x20;
+
+  //connect SPI bus to IO-pins
+  PINSEL0 |= 0x00001500;
+  
+  //send byte
+  SPI_SPDR = data;
+  while((SPI_SPSR & 0x80) == 0)
+    ;
+}
+
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Initialize LCD controller for a window (to write in).
+ *    Set start xy-position and xy-length
+ *    No select/deselect of LCD controller.
+ *
+ ****************************************************************************/
+FASTCODE void
+lcdWindow1(tU8 xp, tU8 yp, tU8 xe, tU8 ye)
+{
+  lcdWrcmd(LCD_CMD_CASET);    //set X
+  lcdWrdata(xp+2);
+	lcdWrdata(xe+2);
+
+	lcdWrcmd(LCD_CMD_PASET);    //set Y
+	lcdWrdata(yp+2);
+	lcdWrdata(ye+2);
+}
+
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Draw a rectangular area with specified color.
+ *
+ ****************************************************************************/
+FASTCODE void
+lcdRect(tU8 x, tU8 y, tU8 xLen, tU8 yLen, tU8 color)
+{
+  tU32 i;
+  tU32 len;
+
+  //select controller
+  selectLCD(TRUE);   
+
+  lcdWindow1(x,y,x+xLen-1,y+yLen-1);
+  
+  lcdWrcmd(LCD_CMD_RAMWR);    //write memory
+  
+  len = xLen*yLen;
+  for(i=0; i<len; i++)
+    lcdWrdata(color);
+
+  //deselect controller
+  selectLCD(FALSE);
+}
+
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Send command data to LCD controller
+ *
+ ****************************************************************************/
+FASTCODE void
+lcdWrcmd(tU8 data)
+{
+  sendToLCD(0, data);
+}
+
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Send data byte to LCD controller
+ *
+ ****************************************************************************/
+FASTCODE void
+lcdWrdata(tU8 data)
+{
+  sendToLCD(1, data);
+}
@@ -18,10 +18,12 @@
 #include "../pre_emptive_os/api/general.h"
 #include <lpc2xxx.h>
 #include "lcd_hw.h"
+#include "mutex.h"
 
 /******************************************************************************
  * Typedefs and defines
  *****************************************************************************/
+#define LCD_LOCK_CEILING 2  /* the game workers, see GAME_WORKER_PRIO */
 
 
 /*****************************************************************************
@@ -31,52 +33,12 @@
 /*****************************************************************************
  * Local variables
  ****************************************************************************/
+static Mutex lcdMutex;
 
 /*****************************************************************************
  * Local prototypes
  ****************************************************************************/
 
-
-/*****************************************************************************
- *
- * Description:
- *    Send 9-bit data to LCD controller
- *
- ****************************************************************************/
-void
-sendToLCD(tU8 firstBit, tU8 data)
-{
-  //disable SPI
-  IOCLR = LCD_CLK;
-  PINSEL0 &= 0xffffc0ff;
-  
-  if (1 == firstBit)
-    IOSET = LCD_MOSI;   //set MOSI
-  else
-    IOCLR = LCD_MOSI;   //reset MOSI
-  
-  //Set clock high
-  IOSET = LCD_CLK;
-  
-  //Set clock low
-  IOCLR = LCD_CLK;
-  
-  /*
-   * Enable SPI again
-   */
-  //initialize SPI interface
-  SPI_SPCCR = 0x08;    
-  SPI_SPCR  = 0x20;
-
-  //connect SPI bus to IO-pins
-  PINSEL0 |= 0x00001500;
-  
-  //send byte
-  SPI_SPDR = data;
-  while((SPI_SPSR & 0x80) == 0)
-    ;
-}
-
 
 /*****************************************************************************
  *
@@ -90,8 +52,9 @@ initSpiForLcd(void)
   //make SPI slave chip select an output and set signal high
   IODIR |= (LCD_CS | LCD_CLK | LCD_MOSI);
   
-  //deselect controller
-  selectLCD(FALSE);
+  //deselect controller, no process owns it yet
+  IOSET = LCD_CS;
+  mutexInit(&lcdMutex, "lcd", LCD_LOCK_CEILING);
 
   //connect SPI bus to IO-pins
   PINSEL0 |= 0x00001500;
@@ -105,13 +68,21 @@ initSpiForLcd(void)
  *
  * Description:
  *    Select/deselect LCD controller (by controlling chip select signal)
+ *    The controller is locked by the selecting process until it is
+ *    deselected, so transfers of different processes do not interleave.
  *
  ****************************************************************************/
 void
 selectLCD(tBool select)
 {
   if (TRUE == select)
+  {
+    mutexLock(&lcdMutex, 0);
     IOCLR = LCD_CS;
+  }
   else
+  {
     IOSET = LCD_CS;
+    mutexUnlock(&lcdMutex);
+  }
 }
\ No newline at end of file
@@ -4,20 +4,21 @@
  *    (C) 2007 Embedded Artists AB
  *
  * File:
- *    pca9532.h
+ *    lcd_hw.h
  *
  * Description:
  *    Expose hardware specific routines
  *
  *****************************************************************************/
-#ifndef _PCA9532_H_
-#define _PCA9532_H_
+#ifndef _LCD_HW_H_
+#define _LCD_HW_H_
 
 /******************************************************************************
  * Includes
  *****************************************************************************/
 #include <general.h>
 #include <lpc2xxx.h>
+#include "fastcode.h"
 
 
 /******************************************************************************
@@ -27,11 +28,30 @@
 #define LCD_CLK    0x00000010
 #define LCD_MOSI   0x00000040
 
+/* controller commands */
+#define LCD_CMD_SWRESET   0x01
+#define LCD_CMD_BSTRON    0x03
+#define LCD_CMD_SLEEPIN   0x10
+#define LCD_CMD_SLEEPOUT  0x11
+#define LCD_CMD_INVON     0x21
+#define LCD_CMD_SETCON    0x25
+#define LCD_CMD_DISPON    0x29
+#define LCD_CMD_CASET     0x2A
+#define LCD_CMD_PASET     0x2B
+#define LCD_CMD_RAMWR     0x2C
+#define LCD_CMD_RGBSET    0x2D
+#define LCD_CMD_MADCTL    0x36
+#define LCD_CMD_COLMOD    0x3A
+
+#define MADCTL_HORIZ      0x48
+#define MADCTL_VERT       0x68
+
 
 /*****************************************************************************
  * Global variables
  ****************************************************************************/
-void sendToLCD(tU8 firstBit, tU8 data);
+FASTCODE void sendToLCD(tU8 firstBit, tU8 data);
+FASTCODE void lcdWindow1(tU8 xp, tU8 yp, tU8 xe, tU8 ye);
 void initSpiForLcd(void);
 void selectLCD(tBool select);
 
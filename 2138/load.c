@@ -0,0 +1,217 @@
+/******************************************************************************
+ *
+ * Copyright:
+ *    Byczki(TM)
+ *
+ * File:
+ *    load.c
+ *
+ * Description:
+ *    Implement the CPU-load meter. The idle hook of the OS is compiled
+ *    into the OS library, so idle time is counted by a process of its
+ *    own on the lowest priority instead. The number of loop iterations
+ *    it manages in a measurement window is compared with the number
+ *    calibrated on an otherwise idle system. Per-process run time is
+ *    sampled from the running process control block on every OS tick.
+ *
+ *****************************************************************************/
+
+#include "pre_emptive_os/core/kernel.h"
+#include <printf_P.h>
+#include "./pca9532.h"
+#include "./stackmon.h"
+#include "./load.h"
+
+#define IDLE_STACK_SIZE 128
+#define IDLE_PRIO (NUM_PRIO - 1)
+
+static tU8 idleStack[IDLE_STACK_SIZE];
+static tU8 pidIdle;
+
+static volatile tBool idleRunning;
+static volatile tU32 idleCount;
+static volatile tU32 windowStartCount;
+static volatile tU32 windowMs;
+static volatile tU32 maxIdleCount = 1;
+
+static volatile tU8 cpuLoad;
+static volatile tU16 runTicks[MAX_NUM_PROC];
+static volatile tU16 lastRunTicks[MAX_NUM_PROC];
+static volatile tU16 lastWindowTicks = 1;
+static volatile tU16 windowTicks;
+
+/*!
+ *  @brief    A procedure counting idle loop iterations
+ *            until idleRunning is cleared. Both the
+ *            calibration and the idle process run this
+ *            one copy of the loop, so an iteration takes
+ *            the same time in both.
+ */
+static void __attribute__((noinline))
+countIdle(void)
+{
+    while (idleRunning)
+        idleCount++;
+}
+
+/*!
+ *  @brief    A procedure counting idle loop iterations.
+ *            It only runs when no other process is ready.
+ *  @param arg
+ *            Not used in this application
+ */
+static void
+idleProc(void *arg)
+{
+    countIdle();
+    osDeleteProcess();
+}
+
+/*!
+ *  @brief    A procedure for calibrating the meter and
+ *            starting the idle process. It spins the idle
+ *            loop for one measurement window, so it must be
+ *            called before any other process is started
+ *            (typically from the init process) and with the
+ *            OS tick running.
+ */
+void
+loadInit(void)
+{
+    tU8 error;
+
+    maxIdleCount = 0;
+    windowMs = 0;
+    idleCount = 0;
+    windowStartCount = 0;
+
+    // loadTick ends the calibration window
+    idleRunning = TRUE;
+    countIdle();
+
+    idleRunning = TRUE;
+    osCreateProcess(idleProc, idleStack, IDLE_STACK_SIZE, &pidIdle, IDLE_PRIO, NULL, &error);
+    osStartProcess(pidIdle, &error);
+    stackMonAddProcess("idle", pidIdle, idleStack, IDLE_STACK_SIZE);
+}
+
+/*!
+ *  @brief    A procedure to be called from the OS tick.
+ *            It samples the running process and closes
+ *            the measurement window when it has elapsed.
+ *            Executes in interrupt context.
+ *  @param elapsedMs
+ *            The number of milliseconds since the last tick.
+ */
+void
+loadTick(tU32 elapsedMs)
+{
+    tU8 i;
+
+    if (pRunProc != NULL)
+    {
+        i = pRunProc - processControlBlocks;
+        if (i < MAX_NUM_PROC) runTicks[i]++;
+    }
+    windowTicks++;
+
+    windowMs += elapsedMs;
+    if (windowMs < LOAD_WINDOW_MS) return;
+    windowMs = 0;
+
+    if (maxIdleCount == 0)
+    {
+        // end of the calibration window
+        maxIdleCount = idleCount > 0 ? idleCount : 1;
+        idleRunning = FALSE;
+    }
+    else
+    {
+        tU32 idle = idleCount - windowStartCount;
+        if (idle > maxIdleCount) idle = maxIdleCount;
+        cpuLoad = 100 - (tU8)(idle * 100 / maxIdleCount);
+    }
+    windowStartCount = idleCount;
+
+    for (i = 0; i < MAX_NUM_PROC; i++)
+    {
+        lastRunTicks[i] = runTicks[i];
+        runTicks[i] = 0;
+    }
+    lastWindowTicks = windowTicks;
+    windowTicks = 0;
+}
+
+/*!
+ *  @brief    A function for reading the CPU load.
+ *  @returns  load in percent over the last
+ *            measurement window
+ */
+tU8
+loadGetCpu(void)
+{
+    return cpuLoad;
+}
+
+/*!
+ *  @brief    A function for reading the share of
+ *            the CPU used by a single process, sampled
+ *            on the OS ticks of the last window.
+ *  @param pid
+ *            Process identification descriptor.
+ *  @returns  run time in percent of the last
+ *            measurement window
+ */
+tU8
+loadGetProcess(tU8 pid)
+{
+    tU8 i;
+
+    for (i = 0; i < MAX_NUM_PROC; i++)
+    {
+        if (processControlBlocks[i].pid == pid)
+            return (tU8)(lastRunTicks[i] * 100 / lastWindowTicks);
+    }
+    return 0;
+}
+
+/*!
+ *  @brief    A procedure for printing the CPU load and
+ *            the run time of every process on the console.
+ */
+void
+loadReport(void)
+{
+    tU8 i;
+
+    printf("\nCPU load: %d%%\n", cpuLoad);
+    printf("pid prio flag run%%\n");
+    for (i = 0; i < MAX_NUM_PROC; i++)
+    {
+        tOSPCB *pcb = &processControlBlocks[i];
+        if (pcb->flag == 0 || (pcb->flag & PROC_ENDED)) continue;
+
+        printf("%d   %d    %x   %d%s\n", pcb->pid, pcb->prio, pcb->flag,
+               lastRunTicks[i] * 100 / lastWindowTicks,
+               pcb->pid == pidIdle ? " (idle)" : "");
+    }
+}
+
+/*!
+ *  @brief    A procedure for showing the CPU load on
+ *            the left half of the PCA9532 LED bar,
+ *            one diod per 12.5 %. Does nothing if the
+ *            PCA9532 has not been found. The game uses
+ *            the same LEDs, so it must not be called
+ *            while a game is running or paused.
+ */
+void
+loadShowOnLeds(void)
+{
+    tU8 lit = (cpuLoad * 8 + 50) / 100;
+    tU8 pin;
+
+    if (pca9532IsPresent() == FALSE) return;
+    for (pin = 0; pin < 8; pin++)
+        setPca9532Pin(pin, pin < lit ? 0 : 1);
+}
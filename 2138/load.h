@@ -0,0 +1,27 @@
+/******************************************************************************
+ *
+ * Copyright:
+ *    Byczki(TM)
+ *
+ * File:
+ *    load.h
+ *
+ * Description:
+ *    Expose the CPU-load and per-process run time meter.
+ *
+ *****************************************************************************/
+#ifndef _LOAD_H_
+#define _LOAD_H_
+
+#include <general.h>
+
+#define LOAD_WINDOW_MS 500
+
+void loadInit(void);
+void loadTick(tU32 elapsedMs);
+tU8 loadGetCpu(void);
+tU8 loadGetProcess(tU8 pid);
+void loadReport(void);
+void loadShowOnLeds(void);
+
+#endif
@@ -20,11 +20,21 @@
 #include "pca9532.h"
 #include "key.h"
 #include "ball_game.h"
+#include "prng.h"
+#include "systime.h"
+#include "load.h"
+#include "stackmon.h"
+#include "cmd.h"
+#include "sampler.h"
+#include "periodic.h"
+#include "osbench.h"
 
 #define PROC1_STACK_SIZE 1024
 #define KEY_CTRL_STACK_SIZE 1024
 #define INIT_STACK_SIZE 400
 
+#define KEY_WAIT_TICKS 10
+
 static tU8 proc1Stack[PROC1_STACK_SIZE];
 static tU8 initStack[INIT_STACK_SIZE];
 
@@ -74,9 +84,11 @@ int main(void)
     tU8 error;
     tU8 pid;
 
+    stackMonInit();
     osInit();
     osCreateProcess(initProc, initStack, INIT_STACK_SIZE, &pid, 1, NULL, &error);
     osStartProcess(pid, &error);
+    stackMonAddProcess("init", pid, initStack, INIT_STACK_SIZE);
 
     osStart();
     return 0;
@@ -101,17 +113,36 @@ proc1(void *arg)
 
     lcdInit();
     initAdc();
+    prngSeedFromHardware();
+    samplerStart(); // oversample the accelerometer, see SAMPLER_RATE_HZ
     drawWelcome();
 
     osSleep(169);
+#ifdef OS_BENCH
+    // the benchmark firmware, see "make osbench", runs no game, which
+    // leaves the OS benchmarks a free process slot for their helper
+    osBenchRun();
+    for (;;)
+    {
+        cmdPoll();
+        osSleep(KEY_WAIT_TICKS);
+    }
+#endif
     initKeyProc();
+    initGame();
 
     IODIR |= (1 << 13) | (1 << 14);
     IOCLR = (1 << 13) | (1 << 14);
 
     for (;;)
     {
-        switch (checkKey())
+        tKeyEvent event;
+
+        stackMonPoll();
+        cmdPoll();
+        if (waitKeyEvent(&event, KEY_WAIT_TICKS) == FALSE) continue;
+
+        switch (event.key)
         {
             case KEY_UP:
                 startGame();
@@ -119,8 +150,21 @@ proc1(void *arg)
             case KEY_DOWN:
                 stopGame();
                 break;
+            case KEY_LEFT:
+                if (event.kind == KEY_EVENT_REPEAT) break;
+                if (getGameState() == GAME_PAUSED) resumeGame();
+                else pauseGame();
+                break;
+            case KEY_CENTER:
+                loadReport();
+                // the game shows the ball row on the same LEDs
+                if (getGameState() != GAME_RUNNING && getGameState() != GAME_PAUSED)
+                    loadShowOnLeds();
+                stackMonReport();
+                printf("key events dropped: %d\n", getKeyEventsDropped());
+                break;
             default:
-                continue;
+                break;
         }
     }
 }
@@ -162,10 +206,15 @@ initProc(void *arg)
 
     eaInit();  // initialize printf
     consolInit();
+    timeInit(); // start the free-running time base
+    periodicInit(); // start the OS timer process
     i2cInit(); // initialize I2C
+    cmdInit(); // receive console input by interrupt
+    loadInit(); // calibrate the CPU-load meter, must precede other processes
 
     osCreateProcess(proc1, proc1Stack, PROC1_STACK_SIZE, &pid1, 3, NULL, &error);
     osStartProcess(pid1, &error);
+    stackMonAddProcess("proc1", pid1, proc1Stack, PROC1_STACK_SIZE);
 
     osDeleteProcess();
 }
@@ -185,4 +234,7 @@ initProc(void *arg)
 void appTick(tU32 elapsedTime)
 {
     msClock += elapsedTime;
+    timeTick(elapsedTime);
+    loadTick(elapsedTime);
+    keyTick();
 }
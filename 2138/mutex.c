@@ -0,0 +1,252 @@
+/******************************************************************************
+ *
+ * Copyright:
+ *    Byczki(TM)
+ *
+ * File:
+ *    mutex.c
+ *
+ * Description:
+ *    Implement mutexes for peripherals shared between processes of
+ *    different priorities. Blocking is done on a binary semaphore, so
+ *    waiters queue in priority order on its OS event.
+ *
+ *    Priority inversion is bounded with immediate priority
+ *    inheritance: the owner takes over the ceiling priority of the
+ *    mutex as soon as it locks it, instead of when a waiter blocks.
+ *    The kernel can only move the running process between priority
+ *    levels of the ready list, and the locker is the running process
+ *    while the waiter is not. No process of a priority up to the
+ *    ceiling can then preempt the owner, so a waiter is blocked for at
+ *    most one critical section. The priority is changed through the
+ *    OS port, see osport.h.
+ *
+ *    A process holding several mutexes runs at the highest ceiling
+ *    among them, so they may be unlocked in any order. Its priority
+ *    is found from the owners of all the mutexes on every unlock.
+ *
+ *    Locks and unlocks by processes other than the owner are refused
+ *    and counted, as are calls from an ISR.
+ *
+ *****************************************************************************/
+
+#include "pre_emptive_os/api/osapi.h"
+#include "pre_emptive_os/core/_oshal/api/a7hal.h"
+#include <printf_P.h>
+#include "./systime.h"
+#include "./osport.h"
+#include "./mutex.h"
+
+static Mutex *mutexes[MUTEX_MAX];
+static tU8 numMutexes;
+
+/*!
+ *  @brief    A function for finding the priority a
+ *            process has without any mutex. Must be
+ *            called with interrupts disabled.
+ *  @param pid
+ *            Process identification descriptor.
+ *  @param prio
+ *            Current priority of the process.
+ *  @returns  the base priority saved by a mutex the
+ *            process holds, or prio if it holds none
+ */
+static tU8
+basePrioOf(tU8 pid, tU8 prio)
+{
+    tU8 i;
+
+    for (i = 0; i < numMutexes; i++)
+    {
+        if (mutexes[i]->owner == pid) return mutexes[i]->basePrio;
+    }
+    return prio;
+}
+
+/*!
+ *  @brief    A function for finding the priority a
+ *            process must run at, the highest of its
+ *            base priority and the ceilings of the
+ *            mutexes it holds. Must be called with
+ *            interrupts disabled.
+ *  @param pid
+ *            Process identification descriptor.
+ *  @param basePrio
+ *            Priority of the process without any mutex.
+ *  @returns  the priority, 0 is the highest
+ */
+static tU8
+heldPrio(tU8 pid, tU8 basePrio)
+{
+    tU8 prio = basePrio;
+    tU8 i;
+
+    for (i = 0; i < numMutexes; i++)
+    {
+        if (mutexes[i]->owner == pid && mutexes[i]->ceiling < prio)
+            prio = mutexes[i]->ceiling;
+    }
+    return prio;
+}
+
+/*!
+ *  @brief    A function for initializing an unlocked
+ *            mutex and registering it. Only registered
+ *            mutexes are seen when the priority of an
+ *            owner is restored, so a mutex that could
+ *            not be registered must not be used.
+ *  @param mutex
+ *            A pointer to the mutex to initialize.
+ *  @param name
+ *            Name shown in the report.
+ *  @param ceiling
+ *            The highest priority (lowest number) of
+ *            the processes using the mutex.
+ *  @returns  false if MUTEX_MAX mutexes are registered
+ */
+tBool
+mutexInit(Mutex *mutex, const char *name, tU8 ceiling)
+{
+    volatile tSR localSR;
+    tBool registered = FALSE;
+
+    osSemInit(&mutex->free, 1);
+    mutex->name = name;
+    mutex->owner = MUTEX_NO_OWNER;
+    mutex->depth = 0;
+    mutex->ceiling = ceiling;
+    mutex->locks = 0;
+    mutex->contended = 0;
+    mutex->errors = 0;
+    mutex->maxWait = 0;
+    mutex->maxHold = 0;
+    mutex->holdUs = 0;
+
+    m_os_dis_int();
+    if (numMutexes < MUTEX_MAX)
+    {
+        mutexes[numMutexes++] = mutex;
+        registered = TRUE;
+    }
+    m_os_ena_int();
+    return registered;
+}
+
+/*!
+ *  @brief    A function for locking a mutex. The owner
+ *            may lock it again, it is released by the
+ *            matching number of unlocks.
+ *  @param mutex
+ *            A pointer to an initialized mutex.
+ *  @param timeout
+ *            Number of ticks to wait, zero means wait
+ *            forever.
+ *  @returns  true if the mutex is locked, false on
+ *            timeout or when called from an ISR
+ */
+tBool
+mutexLock(Mutex *mutex, tU32 timeout)
+{
+    volatile tSR localSR;
+    tU32 start = timeCycles();
+    tU32 wait;
+    tU8 error;
+    tU8 prio;
+    tU8 pid;
+
+    if (osPortInIsr())
+    {
+        mutex->errors++;
+        return FALSE;
+    }
+    pid = osPortRunningPid();
+    if (mutex->owner == pid)
+    {
+        mutex->depth++;
+        return TRUE;
+    }
+
+    m_os_dis_int();
+    if (mutex->owner != MUTEX_NO_OWNER) mutex->contended++;
+    m_os_ena_int();
+    if (osSemTake(&mutex->free, timeout, &error) == FALSE) return FALSE;
+
+    m_os_dis_int();
+    prio = osPortRunningPrio();
+    mutex->basePrio = basePrioOf(pid, prio);
+    mutex->owner = pid;
+    mutex->depth = 1;
+    if (mutex->ceiling < prio) osPortSetRunningPrio(mutex->ceiling);
+    m_os_ena_int();
+
+    mutex->lockedAt = timeCycles();
+    wait = mutex->lockedAt - start;
+    if (wait > mutex->maxWait) mutex->maxWait = wait;
+    mutex->locks++;
+    return TRUE;
+}
+
+/*!
+ *  @brief    A function for unlocking a mutex. The last
+ *            unlock drops the owner to the highest
+ *            ceiling of the mutexes it still holds, or
+ *            to its own priority, and wakes the first
+ *            waiter.
+ *  @param mutex
+ *            A pointer to a mutex locked by the caller.
+ *  @returns  false if the caller is not the owner
+ */
+tBool
+mutexUnlock(Mutex *mutex)
+{
+    volatile tSR localSR;
+    tBool lowered;
+    tU32 hold;
+    tU8 error;
+    tU8 prio;
+
+    if (osPortInIsr() || mutex->owner != osPortRunningPid())
+    {
+        mutex->errors++;
+        return FALSE;
+    }
+    if (--mutex->depth > 0) return TRUE;
+
+    hold = timeCycles() - mutex->lockedAt;
+    if (hold > mutex->maxHold) mutex->maxHold = hold;
+    mutex->holdUs += timeCyclesToUs(hold);
+
+    // drop the priority and wake the waiter in one go, so that no
+    // process in between can run while the waiter is still blocked
+    m_os_dis_int();
+    mutex->owner = MUTEX_NO_OWNER;
+    prio = heldPrio(osPortRunningPid(), mutex->basePrio);
+    lowered = osPortRunningPrio() != prio;
+    osPortSetRunningPrio(prio);
+    osSemGive(&mutex->free, &error);
+    if (lowered) osPortSchedule();
+    m_os_ena_int();
+    return TRUE;
+}
+
+/*!
+ *  @brief    A procedure printing the contention and
+ *            hold times of all the mutexes.
+ */
+void
+mutexReport(void)
+{
+    tU8 i;
+
+    printf("mutex  locks  contended  wait max  hold max  hold avg [us]  errors\n");
+    for (i = 0; i < numMutexes; i++)
+    {
+        Mutex *mutex = mutexes[i];
+        tU32 locks = mutex->locks > 0 ? mutex->locks : 1;
+
+        printf("%s  %u  %u  %u  %u  %u  %u\n", mutex->name,
+               mutex->locks, mutex->contended,
+               timeCyclesToUs(mutex->maxWait), timeCyclesToUs(mutex->maxHold),
+               mutex->holdUs / locks, mutex->errors);
+    }
+}
@@ -0,0 +1,49 @@
+/******************************************************************************
+ *
+ * Copyright:
+ *    Byczki(TM)
+ *
+ * File:
+ *    mutex.h
+ *
+ * Description:
+ *    Expose public functions and types of the priority-ceiling mutexes.
+ *
+ *****************************************************************************/
+#ifndef _MUTEX_H_
+#define _MUTEX_H_
+
+#include "pre_emptive_os/api/osapi.h"
+#include <general.h>
+
+#define MUTEX_MAX 4
+#define MUTEX_NO_OWNER 0xff
+
+/*
+ * A recursive mutex owned by a process. While the mutex is held the
+ * owner runs at the ceiling priority, the highest priority of any of
+ * its users. Times are in timer cycles, see timeCycles.
+ */
+typedef struct Mutex
+{
+    const char *name;
+    tCntSem free;
+    tU8 owner;          /* pid of the owner, or MUTEX_NO_OWNER */
+    tU8 depth;
+    tU8 ceiling;
+    tU8 basePrio;       /* priority of the owner without any mutex */
+    tU32 lockedAt;
+    tU32 locks;
+    tU32 contended;
+    tU32 errors;
+    tU32 maxWait;
+    tU32 maxHold;
+    tU32 holdUs;
+} Mutex;
+
+tBool mutexInit(Mutex *mutex, const char *name, tU8 ceiling);
+tBool mutexLock(Mutex *mutex, tU32 timeout);
+tBool mutexUnlock(Mutex *mutex);
+void mutexReport(void);
+
+#endif
@@ -0,0 +1,485 @@
+/******************************************************************************
+ *
+ * Copyright:
+ *    Byczki(TM)
+ *
+ * File:
+ *    osbench.c
+ *
+ * Description:
+ *    Implement micro-benchmarks of the OS and of the synchronization
+ *    primitives built on it. Every operation is timed on its own with
+ *    the free-running timer, less the cost of reading the timer, and
+ *    the minimum, average and maximum over the rounds are reported in
+ *    timer cycles, so the spread left by OS ticks and interrupts stays
+ *    visible instead of being averaged away.
+ *
+ *    The ping-pong benchmarks pass a semaphore or a queue message to
+ *    a helper process of higher priority and back, i.e. every round
+ *    makes two context switches. The helper needs a free process
+ *    slot, which the game firmware does not have; build the
+ *    benchmark firmware with "make osbench" to run them.
+ *
+ *****************************************************************************/
+
+#include "pre_emptive_os/api/osapi.h"
+#include <printf_P.h>
+#include "./systime.h"
+#include "./mutex.h"
+#include "./eventflags.h"
+#include "./ring.h"
+#include "./pool.h"
+#include "./osbench.h"
+
+#define OSBENCH_ROUNDS 64
+#define OSBENCH_HELPER_PRIO 2
+#define OSBENCH_HELPER_STACK_SIZE 256
+#define OSBENCH_QUEUE_SIZE 4
+#define OSBENCH_RING_SIZE 8
+#define OSBENCH_FLAG 0x01
+#define NO_PROCESS "no free process (make osbench)"
+
+typedef struct BenchStats
+{
+    tU32 min;
+    tU32 max;
+    tU32 sum;
+    tU32 count;
+} BenchStats;
+
+typedef struct OsBenchmark
+{
+    const char *name;
+    const char *(*run)(BenchStats *stats);
+} OsBenchmark;
+
+static const char *semBench(BenchStats *stats);
+static const char *queueBench(BenchStats *stats);
+static const char *mutexBench(BenchStats *stats);
+static const char *flagsBench(BenchStats *stats);
+static const char *ringBench(BenchStats *stats);
+static const char *poolBench(BenchStats *stats);
+static const char *semPingPongBench(BenchStats *stats);
+static const char *queuePingPongBench(BenchStats *stats);
+static const char *sleepBench(BenchStats *stats);
+
+static const OsBenchmark benchmarks[] =
+{
+    { "sem give+take", semBench },
+    { "queue post+pend", queueBench },
+    { "mutex lock+unlock", mutexBench },
+    { "flags set+wait", flagsBench },
+    { "ring push+pop", ringBench },
+    { "memAlloc+memFree", poolBench },
+    { "sem ping-pong", semPingPongBench },
+    { "queue ping-pong", queuePingPongBench },
+    { "osSleep(1) period", sleepBench }
+};
+
+#define NUM_BENCHMARKS (sizeof(benchmarks) / sizeof(benchmarks[0]))
+
+// indices of the results the context switch is derived from
+#define SEM_BENCH 0
+#define SEM_PING_PONG_BENCH 6
+
+static tU8 helperStack[OSBENCH_HELPER_STACK_SIZE];
+static tCntSem ping;
+static tCntSem pong;
+static tQueue requests;
+static tQueue replies;
+static void *requestArea[OSBENCH_QUEUE_SIZE];
+static void *replyArea[OSBENCH_QUEUE_SIZE];
+static Mutex benchMutex;
+static EventFlags benchFlags;
+static Ring benchRing;
+static RING_STORAGE(benchRingArea, OSBENCH_RING_SIZE, sizeof(tU32));
+static tBool initialized;
+static tBool mutexRegistered;
+static tU32 timerOverhead;
+
+/*!
+ *  @brief    A procedure for adding a sample to
+ *            the statistics.
+ *  @param stats
+ *            A pointer to the statistics.
+ *  @param start
+ *            Timer cycles read before the operation.
+ */
+static void
+addSample(BenchStats *stats, tU32 start)
+{
+    tU32 cycles = timeCycles() - start;
+
+    cycles = cycles > timerOverhead ? cycles - timerOverhead : 0;
+    if (cycles < stats->min) stats->min = cycles;
+    if (cycles > stats->max) stats->max = cycles;
+    stats->sum += cycles;
+    stats->count++;
+}
+
+/*!
+ *  @brief    A procedure for measuring the cost of
+ *            reading the timer, which is subtracted
+ *            from every sample.
+ */
+static void
+measureTimerOverhead(void)
+{
+    tU8 i;
+
+    timerOverhead = 0xffffffff;
+    for (i = 0; i < OSBENCH_ROUNDS; i++)
+    {
+        tU32 start = timeCycles();
+        tU32 cycles = timeCycles() - start;
+        if (cycles < timerOverhead) timerOverhead = cycles;
+    }
+}
+
+/*!
+ *  @brief    A function for starting a helper process
+ *            on the priority above the caller.
+ *  @param entry
+ *            Entry function of the helper, which must
+ *            delete itself when done.
+ *  @returns  false if there is no free process slot
+ */
+static tBool
+startHelper(void (*entry)(void *arg))
+{
+    tU8 pid;
+    tU8 error;
+
+    osCreateProcess(entry, helperStack, OSBENCH_HELPER_STACK_SIZE, &pid,
+                    OSBENCH_HELPER_PRIO, NULL, &error);
+    if (error != OS_OK) return FALSE;
+    osStartProcess(pid, &error);
+    return TRUE;
+}
+
+/*!
+ *  @brief    Benchmark of a semaphore give and an
+ *            uncontended take, without a switch.
+ *  @param stats
+ *            Statistics to add the samples to.
+ *  @returns  NULL, or why the benchmark could not run
+ */
+static const char *
+semBench(BenchStats *stats)
+{
+    tU8 error;
+    tU8 i;
+
+    for (i = 0; i < OSBENCH_ROUNDS; i++)
+    {
+        tU32 start = timeCycles();
+        osSemGive(&ping, &error);
+        osSemTake(&ping, 0, &error);
+        addSample(stats, start);
+    }
+    return NULL;
+}
+
+/*!
+ *  @brief    Benchmark of a queue post and a pend of
+ *            the posted message, without a switch.
+ *  @param stats
+ *            Statistics to add the samples to.
+ *  @returns  NULL, or why the benchmark could not run
+ */
+static const char *
+queueBench(BenchStats *stats)
+{
+    tU8 error;
+    tU8 i;
+
+    for (i = 0; i < OSBENCH_ROUNDS; i++)
+    {
+        tU32 start = timeCycles();
+        osPostQueue(&requests, (void *)1, &error);
+        osPendQueue(&requests, 0, &error);
+        addSample(stats, start);
+    }
+    return NULL;
+}
+
+/*!
+ *  @brief    Benchmark of an uncontended mutex lock
+ *            and unlock.
+ *  @param stats
+ *            Statistics to add the samples to.
+ *  @returns  NULL, or why the benchmark could not run
+ */
+static const char *
+mutexBench(BenchStats *stats)
+{
+    tU8 i;
+
+    if (mutexRegistered == FALSE) return "no free mutex (MUTEX_MAX)";
+    for (i = 0; i < OSBENCH_ROUNDS; i++)
+    {
+        tU32 start = timeCycles();
+        mutexLock(&benchMutex, 0);
+        mutexUnlock(&benchMutex);
+        addSample(stats, start);
+    }
+    return NULL;
+}
+
+/*!
+ *  @brief    Benchmark of setting a flag and a wait
+ *            consuming it, without a switch.
+ *  @param stats
+ *            Statistics to add the samples to.
+ *  @returns  NULL, or why the benchmark could not run
+ */
+static const char *
+flagsBench(BenchStats *stats)
+{
+    tU8 i;
+
+    for (i = 0; i < OSBENCH_ROUNDS; i++)
+    {
+        tU32 start = timeCycles();
+        eventFlagsSet(&benchFlags, OSBENCH_FLAG);
+        eventFlagsWait(&benchFlags, OSBENCH_FLAG,
+                       EVENT_FLAGS_ANY | EVENT_FLAGS_CLEAR, 0);
+        addSample(stats, start);
+    }
+    return NULL;
+}
+
+/*!
+ *  @brief    Benchmark of a ring push and pop of a
+ *            single word.
+ *  @param stats
+ *            Statistics to add the samples to.
+ *  @returns  NULL, or why the benchmark could not run
+ */
+static const char *
+ringBench(BenchStats *stats)
+{
+    tU32 value = 0;
+    tU8 i;
+
+    for (i = 0; i < OSBENCH_ROUNDS; i++)
+    {
+        tU32 start = timeCycles();
+        ringPush(&benchRing, &value);
+        ringPop(&benchRing, &value);
+        addSample(stats, start);
+    }
+    return NULL;
+}
+
+/*!
+ *  @brief    Benchmark of memAlloc and memFree of
+ *            the smallest size class, which is created
+ *            on the first run.
+ *  @param stats
+ *            Statistics to add the samples to.
+ *  @returns  NULL, or why the benchmark could not run
+ */
+static const char *
+poolBench(BenchStats *stats)
+{
+    tU8 i;
+
+    if (memInit() == FALSE) return "no heap for the memAlloc classes";
+    for (i = 0; i < OSBENCH_ROUNDS; i++)
+    {
+        tU32 start = timeCycles();
+        memFree(memAlloc(MEM_SMALL_SIZE));
+        addSample(stats, start);
+    }
+    return NULL;
+}
+
+/*!
+ *  @brief    Entry function of the semaphore ping-pong
+ *            helper, answering every ping with a pong.
+ *  @param arg
+ *            Not used.
+ */
+static void
+semHelper(void *arg)
+{
+    tU8 error;
+    tU8 i;
+
+    for (i = 0; i < OSBENCH_ROUNDS; i++)
+    {
+        osSemTake(&ping, 0, &error);
+        osSemGive(&pong, &error);
+    }
+    osDeleteProcess();
+}
+
+/*!
+ *  @brief    Benchmark of a semaphore round trip
+ *            through the helper process.
+ *  @param stats
+ *            Statistics to add the samples to.
+ *  @returns  NULL, or why the benchmark could not run
+ */
+static const char *
+semPingPongBench(BenchStats *stats)
+{
+    tU8 error;
+    tU8 i;
+
+    if (startHelper(semHelper) == FALSE) return NO_PROCESS;
+
+    for (i = 0; i < OSBENCH_ROUNDS; i++)
+    {
+        tU32 start = timeCycles();
+        osSemGive(&ping, &error);
+        osSemTake(&pong, 0, &error);
+        addSample(stats, start);
+    }
+    return NULL;
+}
+
+/*!
+ *  @brief    Entry function of the queue ping-pong
+ *            helper, sending every request back.
+ *  @param arg
+ *            Not used.
+ */
+static void
+queueHelper(void *arg)
+{
+    tU8 error;
+    tU8 i;
+
+    for (i = 0; i < OSBENCH_ROUNDS; i++)
+        osPostQueue(&replies, osPendQueue(&requests, 0, &error), &error);
+    osDeleteProcess();
+}
+
+/*!
+ *  @brief    Benchmark of a queue message round trip
+ *            through the helper process.
+ *  @param stats
+ *            Statistics to add the samples to.
+ *  @returns  NULL, or why the benchmark could not run
+ */
+static const char *
+queuePingPongBench(BenchStats *stats)
+{
+    tU8 error;
+    tU8 i;
+
+    if (startHelper(queueHelper) == FALSE) return NO_PROCESS;
+
+    for (i = 0; i < OSBENCH_ROUNDS; i++)
+    {
+        tU32 start = timeCycles();
+        osPostQueue(&requests, (void *)1, &error);
+        osPendQueue(&replies, 0, &error);
+        addSample(stats, start);
+    }
+    return NULL;
+}
+
+/*!
+ *  @brief    Benchmark of the period of a loop
+ *            sleeping a single tick. Its spread is the
+ *            wake-up jitter.
+ *  @param stats
+ *            Statistics to add the samples to.
+ *  @returns  NULL, or why the benchmark could not run
+ */
+static const char *
+sleepBench(BenchStats *stats)
+{
+    tU32 last;
+    tU8 i;
+
+    // start right after a tick
+    osSleep(1);
+    last = timeCycles();
+    for (i = 0; i < OSBENCH_ROUNDS; i++)
+    {
+        osSleep(1);
+        addSample(stats, last);
+        last = timeCycles();
+    }
+    return NULL;
+}
+
+/*!
+ *  @brief    A function converting timer cycles to
+ *            nanoseconds.
+ *  @param cycles
+ *            Timer cycles, less than 4 million.
+ *  @returns  the time in nanoseconds
+ */
+static tU32
+cyclesToNs(tU32 cycles)
+{
+    return timeCyclesToUs(cycles * 1000);
+}
+
+/*!
+ *  @brief    A procedure running all the benchmarks
+ *            and printing a table of the results. Must
+ *            be called from a process below the helper
+ *            priority, i.e. of priority 3 or 4.
+ */
+void
+osBenchRun(void)
+{
+    BenchStats results[NUM_BENCHMARKS];
+    const char *reason;
+    tU8 i;
+
+    if (initialized == FALSE)
+    {
+        osSemInit(&ping, 0);
+        osSemInit(&pong, 0);
+        osCreateQueue(&requests, requestArea, OSBENCH_QUEUE_SIZE);
+        osCreateQueue(&replies, replyArea, OSBENCH_QUEUE_SIZE);
+        mutexRegistered = mutexInit(&benchMutex, "osbench",
+                                    OSBENCH_HELPER_PRIO);
+        eventFlagsInit(&benchFlags);
+        ringInit(&benchRing, benchRingArea, sizeof(tU32), OSBENCH_RING_SIZE);
+        initialized = TRUE;
+    }
+    measureTimerOverhead();
+
+    printf("benchmark  min  avg  max [cycles]  avg [ns]\n");
+    for (i = 0; i < NUM_BENCHMARKS; i++)
+    {
+        BenchStats *stats = &results[i];
+
+        stats->min = 0xffffffff;
+        stats->max = 0;
+        stats->sum = 0;
+        stats->count = 0;
+        reason = benchmarks[i].run(stats);
+        if (reason != NULL || stats->count == 0)
+        {
+            stats->count = 0;
+            printf("%s  skipped, %s\n", benchmarks[i].name,
+                   reason != NULL ? reason : "no samples");
+            continue;
+        }
+
+        printf("%s  %u  %u  %u  %u\n", benchmarks[i].name,
+               stats->min, stats->sum / stats->count, stats->max,
+               cyclesToNs(stats->sum / stats->count));
+    }
+
+    // a round of the ping-pong is two switches and two give-take pairs
+    if (results[SEM_PING_PONG_BENCH].count > 0)
+    {
+        tU32 roundTrip = results[SEM_PING_PONG_BENCH].min;
+        tU32 semOps = 2 * results[SEM_BENCH].min;
+
+        printf("context switch  ~%u cycles, %u ns\n",
+               roundTrip > semOps ? (roundTrip - semOps) / 2 : 0,
+               cyclesToNs(roundTrip > semOps ? (roundTrip - semOps) / 2 : 0));
+    }
+    printf("timer read  %u cycles, subtracted\n", timerOverhead);
+}
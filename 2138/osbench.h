@@ -0,0 +1,20 @@
+/******************************************************************************
+ *
+ * Copyright:
+ *    Byczki(TM)
+ *
+ * File:
+ *    osbench.h
+ *
+ * Description:
+ *    Expose public functions of the OS micro-benchmarks.
+ *
+ *****************************************************************************/
+#ifndef _OSBENCH_H_
+#define _OSBENCH_H_
+
+#include <general.h>
+
+void osBenchRun(void);
+
+#endif
@@ -0,0 +1,86 @@
+/******************************************************************************
+ *
+ * Copyright:
+ *    Byczki(TM)
+ *
+ * File:
+ *    osport.c
+ *
+ * Description:
+ *    Implement the kernel services missing from osapi.h on the
+ *    internals declared in core/kernel.h: the running process, the
+ *    ISR nesting level, the ready list and the scheduler. It depends
+ *    on the pcb layout and on the ready list keeping one queue per
+ *    priority level, as in the current OS library.
+ *
+ *    The kernel can only move the running process between priority
+ *    levels, as it is the head of its queue. The priority of a
+ *    blocked or ready process cannot be changed here.
+ *
+ *****************************************************************************/
+
+#include "pre_emptive_os/core/kernel.h"
+#include "./osport.h"
+
+/*!
+ *  @brief    A function checking if the caller runs
+ *            in interrupt context.
+ *  @returns  true inside an ISR
+ */
+tBool
+osPortInIsr(void)
+{
+    return isrNesting > 0;
+}
+
+/*!
+ *  @brief    A function for reading the process
+ *            identification descriptor of the running
+ *            process.
+ *  @returns  the pid of the running process
+ */
+tU8
+osPortRunningPid(void)
+{
+    return pRunProc->pid;
+}
+
+/*!
+ *  @brief    A function for reading the current
+ *            priority of the running process.
+ *  @returns  the priority, 0 is the highest
+ */
+tU8
+osPortRunningPrio(void)
+{
+    return pRunProc->prio;
+}
+
+/*!
+ *  @brief    A procedure for moving the running
+ *            process to another priority level. It does
+ *            not reschedule, see osPortSchedule. Must
+ *            be called with interrupts disabled.
+ *  @param prio
+ *            New priority of the running process.
+ */
+void
+osPortSetRunningPrio(tU8 prio)
+{
+    if (pRunProc->prio == prio) return;
+    rmvFromRdyList();
+    pRunProc->prio = prio;
+    addToRdyList(pRunProc);
+}
+
+/*!
+ *  @brief    A procedure switching to a ready process
+ *            of a higher priority, if there is one, for
+ *            example after osPortSetRunningPrio has
+ *            lowered the running process.
+ */
+void
+osPortSchedule(void)
+{
+    schedule();
+}
@@ -0,0 +1,28 @@
+/******************************************************************************
+ *
+ * Copyright:
+ *    Byczki(TM)
+ *
+ * File:
+ *    osport.h
+ *
+ * Description:
+ *    Expose the few kernel services of the OS that osapi.h does not
+ *    export. The OS is shipped as a library, so these are built on
+ *    its internal state and must be checked with every new drop of
+ *    the library. No other application file may use kernel internals
+ *    for scheduling.
+ *
+ *****************************************************************************/
+#ifndef _OSPORT_H_
+#define _OSPORT_H_
+
+#include <general.h>
+
+tBool osPortInIsr(void);
+tU8 osPortRunningPid(void);
+tU8 osPortRunningPrio(void);
+void osPortSetRunningPrio(tU8 prio);
+void osPortSchedule(void);
+
+#endif
@@ -33,6 +33,7 @@
 /*****************************************************************************
  * Local variables
  ****************************************************************************/
+static tBool present = FALSE;
 
 /*****************************************************************************
  * Local prototypes
@@ -52,11 +53,29 @@ pca9532Init(void)
   //                                                         04 = LCD_RST# low
   //                                                         10 = BT_RST# low
 
+  tS8 retCode;
+
   //initialize PCA9532
-  if (I2C_CODE_OK == pca9532(initCommand, sizeof(initCommand), NULL, 0))
-    return TRUE;
-  else
-    return FALSE;
+  i2cLock();
+  retCode = pca9532(initCommand, sizeof(initCommand), NULL, 0);
+  i2cUnlock();
+
+  present = (I2C_CODE_OK == retCode) ? TRUE : FALSE;
+  return present;
+}
+
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Tell if the last call to pca9532Init found the device, without
+ *    touching the bus
+ *
+ ****************************************************************************/
+tBool
+pca9532IsPresent(void)
+{
+  return present;
 }
 
 
@@ -81,6 +100,8 @@ setPca9532Pin(tU8 pinNum, tU8 value)
   else
     command[0] = 0x09;
     
+  //read-modify-write, the bus is held over both transactions
+  i2cLock();
   pca9532(command, 1, &regValue, 1);
   
   mask = (3 << 2*(pinNum % 4));
@@ -97,6 +118,7 @@ setPca9532Pin(tU8 pinNum, tU8 value)
   command[1] |= regValue;
 
   pca9532(command, sizeof(command), NULL, 0);
+  i2cUnlock();
 }
 
 
@@ -111,7 +133,9 @@ getPca9532Pin(void)
   tU8 command[] = {0x19};
   tU8 regValue[3];
   
+  i2cLock();
   pca9532(command, 1, regValue, 3);
+  i2cUnlock();
   
   return (tU16)regValue[1] | ((tU16)regValue[2] << 8);
 }
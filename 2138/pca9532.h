@@ -29,6 +29,7 @@
  * Global variables
  ****************************************************************************/
 tBool pca9532Init(void);
+tBool pca9532IsPresent(void);
 void  setPca9532Pin(tU8 pinNum, tU8 value);
 tU16  getPca9532Pin(void);
 
@@ -0,0 +1,261 @@
+/******************************************************************************
+ *
+ * Copyright:
+ *    Byczki(TM)
+ *
+ * File:
+ *    periodic.c
+ *
+ * Description:
+ *    Implement periodic tasks on top of the OS timers. Each task has
+ *    a repeating timer whose callback gives the release semaphore of
+ *    the task, so the period is kept by the timer process and is not
+ *    stretched by the work or by preemption. The time of each release
+ *    is recorded, and a step that has not come back to periodicWait by
+ *    the end of its period is counted as an overrun. A release that
+ *    finds the previous one still not taken is dropped instead of
+ *    being queued, so a late task does not run a burst of steps.
+ *
+ *    OS timer callbacks take no argument, hence every task slot has
+ *    its own callback.
+ *
+ *****************************************************************************/
+
+#include "pre_emptive_os/api/osapi.h"
+#include "pre_emptive_os/core/_oshal/api/a7hal.h"
+#include <printf_P.h>
+#include "./systime.h"
+#include "./periodic.h"
+
+static PeriodicTask *tasks[PERIODIC_MAX_TASKS];
+
+/*!
+ *  @brief    A procedure releasing the task of a slot,
+ *            called by the timer process.
+ *  @param slot
+ *            Slot of the task.
+ */
+static void
+releaseTask(tU8 slot)
+{
+    PeriodicTask *task = tasks[slot];
+    tU8 error;
+
+    if (task == NULL) return;
+    task->releases++;
+    if (task->pending) return;
+    task->releasedUs = timeNowUs();
+    task->pending = TRUE;
+    osSemGive(&task->release, &error);
+}
+
+#define SLOT_CALLBACK(n) static void releaseSlot##n(void) { releaseTask(n); }
+SLOT_CALLBACK(0) SLOT_CALLBACK(1) SLOT_CALLBACK(2) SLOT_CALLBACK(3)
+#undef SLOT_CALLBACK
+
+static void (* const callbacks[PERIODIC_MAX_TASKS])(void) =
+{
+    releaseSlot0, releaseSlot1, releaseSlot2, releaseSlot3
+};
+
+/*!
+ *  @brief    A function for converting a period to
+ *            whole OS ticks, at least one.
+ *  @param periodMs
+ *            Period in milliseconds.
+ *  @returns  the period in ticks
+ */
+static tU32
+toTicks(tU32 periodMs)
+{
+    tU32 tickMs = timeTickMs();
+    tU32 ticks = (periodMs + tickMs / 2) / tickMs;
+    return ticks > 0 ? ticks : 1;
+}
+
+/*!
+ *  @brief    A function for reading the period of a
+ *            task in microseconds.
+ *  @param task
+ *            A pointer to the task.
+ *  @returns  the period in microseconds
+ */
+static tU32
+periodUs(PeriodicTask *task)
+{
+    return task->periodTicks * timeTickMs() * 1000;
+}
+
+/*!
+ *  @brief    A function for finding the slot of a task.
+ *  @param task
+ *            A pointer to the task.
+ *  @returns  the slot, or PERIODIC_MAX_TASKS if the
+ *            task is not started
+ */
+static tU8
+slotOf(PeriodicTask *task)
+{
+    tU8 slot;
+
+    for (slot = 0; slot < PERIODIC_MAX_TASKS; slot++)
+    {
+        if (tasks[slot] == task) break;
+    }
+    return slot;
+}
+
+/*!
+ *  @brief    A procedure for starting the OS timer
+ *            process. It takes a process slot and runs
+ *            at priority 0, so it must be called once
+ *            before any task is started.
+ */
+void
+periodicInit(void)
+{
+    tU8 error;
+
+    osInitTimers(&error);
+    if (error != OS_OK) printf("periodic: no process for the timers\n");
+}
+
+/*!
+ *  @brief    A function for starting a periodic task.
+ *            The first release comes one period after
+ *            the call.
+ *  @param task
+ *            A pointer to the task structure.
+ *  @param name
+ *            Name shown in the report.
+ *  @param periodMs
+ *            Period in milliseconds, rounded to whole
+ *            OS ticks.
+ *  @returns  true if the task has been started, false
+ *            if all PERIODIC_MAX_TASKS slots are in use
+ */
+tBool
+periodicStart(PeriodicTask *task, const char *name, tU32 periodMs)
+{
+    volatile tSR localSR;
+    tU8 slot;
+
+    osSemInit(&task->release, 0);
+    task->name = name;
+    task->periodTicks = toTicks(periodMs);
+    task->pending = FALSE;
+    task->busy = FALSE;
+    task->releases = 0;
+    task->overruns = 0;
+
+    m_os_dis_int();
+    slot = slotOf(NULL);
+    if (slot < PERIODIC_MAX_TASKS) tasks[slot] = task;
+    m_os_ena_int();
+
+    if (slot == PERIODIC_MAX_TASKS) return FALSE;
+    osCreateTimer(&task->timer, callbacks[slot], TRUE, task->periodTicks);
+    return TRUE;
+}
+
+/*!
+ *  @brief    A procedure for stopping a periodic task.
+ *            Its slot and the task structure may then
+ *            be reused.
+ *  @param task
+ *            A pointer to a started task.
+ */
+void
+periodicStop(PeriodicTask *task)
+{
+    tU8 slot = slotOf(task);
+    tU8 error;
+
+    if (slot == PERIODIC_MAX_TASKS) return;
+    osDeleteTimer(&task->timer, &error);
+    tasks[slot] = NULL;
+}
+
+/*!
+ *  @brief    A procedure ending the step of the task,
+ *            counting an overrun if it is past its
+ *            deadline, and blocking the calling process
+ *            until the next release.
+ *  @param task
+ *            A pointer to a started task.
+ */
+void
+periodicWait(PeriodicTask *task)
+{
+    volatile tSR localSR;
+    tU8 error;
+
+    if (task->busy && (tS32)(timeNowUs() - task->deadlineUs) > 0)
+        task->overruns++;
+
+    osSemTake(&task->release, 0, &error);
+
+    m_os_dis_int();
+    task->deadlineUs = task->releasedUs + periodUs(task);
+    task->pending = FALSE;
+    m_os_ena_int();
+    task->busy = TRUE;
+}
+
+/*!
+ *  @brief    A procedure for changing the period of
+ *            a task. Should be called right after a
+ *            release, the next one then comes one new
+ *            period after the call. Does nothing if the
+ *            period rounds to the same number of ticks.
+ *  @param task
+ *            A pointer to a started task.
+ *  @param periodMs
+ *            New period in milliseconds.
+ */
+void
+periodicSetPeriod(PeriodicTask *task, tU32 periodMs)
+{
+    tU32 ticks = toTicks(periodMs);
+    tU8 slot = slotOf(task);
+    tU8 error;
+
+    if (slot == PERIODIC_MAX_TASKS || ticks == task->periodTicks) return;
+
+    osDeleteTimer(&task->timer, &error);
+    task->periodTicks = ticks;
+    task->deadlineUs = timeNowUs() + periodUs(task);
+    osCreateTimer(&task->timer, callbacks[slot], TRUE, ticks);
+}
+
+/*!
+ *  @brief    A function for reading the number of
+ *            steps that ended after their deadline.
+ *  @param task
+ *            A pointer to the task.
+ *  @returns  the number of overruns since the start
+ */
+tU32
+periodicGetOverruns(PeriodicTask *task)
+{
+    return task->overruns;
+}
+
+/*!
+ *  @brief    A procedure printing the period, releases
+ *            and overruns of all the running tasks.
+ */
+void
+periodicReport(void)
+{
+    tU8 slot;
+
+    printf("task  period ms  releases  overruns\n");
+    for (slot = 0; slot < PERIODIC_MAX_TASKS; slot++)
+    {
+        PeriodicTask *task = tasks[slot];
+        if (task == NULL) continue;
+        printf("%s  %u  %u  %u\n", task->name, task->periodTicks * timeTickMs(),
+               task->releases, task->overruns);
+    }
+}
@@ -0,0 +1,52 @@
+/******************************************************************************
+ *
+ * Copyright:
+ *    Byczki(TM)
+ *
+ * File:
+ *    periodic.h
+ *
+ * Description:
+ *    Expose public functions and types of the periodic tasks.
+ *
+ *****************************************************************************/
+#ifndef _PERIODIC_H_
+#define _PERIODIC_H_
+
+#include "pre_emptive_os/api/osapi.h"
+#include <general.h>
+
+#define PERIODIC_MAX_TASKS 4
+
+/*
+ * A process released at a fixed rate by a repeating OS timer. The
+ * structure is allocated by the user, like tTimer, and must stay
+ * valid until periodicStop.
+ *
+ * The timer counts OS ticks, so periods are rounded to whole ticks
+ * of timeTickMs() milliseconds and releases jitter by up to a tick.
+ * Deadlines are checked against timeNowUs().
+ */
+typedef struct PeriodicTask
+{
+    tTimer timer;
+    tCntSem release;
+    const char *name;
+    tU32 periodTicks;
+    volatile tU32 releasedUs;   /* time of the pending release */
+    volatile tBool pending;     /* released and not yet taken */
+    tBool busy;                 /* running the step of a release */
+    tU32 deadlineUs;            /* end of the period of that step */
+    volatile tU32 releases;
+    volatile tU32 overruns;
+} PeriodicTask;
+
+void periodicInit(void);
+tBool periodicStart(PeriodicTask *task, const char *name, tU32 periodMs);
+void periodicStop(PeriodicTask *task);
+void periodicWait(PeriodicTask *task);
+void periodicSetPeriod(PeriodicTask *task, tU32 periodMs);
+tU32 periodicGetOverruns(PeriodicTask *task);
+void periodicReport(void);
+
+#endif
@@ -0,0 +1,283 @@
+/******************************************************************************
+ *
+ * Copyright:
+ *    Byczki(TM)
+ *
+ * File:
+ *    pool.c
+ *
+ * Description:
+ *    Implement fixed-block memory pools over the heap between the end
+ *    of the static data and the exception stacks (pHeapStart and
+ *    pHeapEnd, set in exceptionHandlerInit). Pools are carved from
+ *    the heap at start-up and never returned, so there is no
+ *    fragmentation. Allocation and release are O(1) with interrupts
+ *    disabled only for a few instructions, so both may be used from
+ *    an ISR.
+ *
+ *    Every pool is also a size class of memAlloc, which takes a
+ *    block from the smallest class that fits and has one free. The
+ *    default classes are only created by memInit, so the heap is not
+ *    taken unless something uses memAlloc.
+ *
+ *****************************************************************************/
+
+#include "pre_emptive_os/api/osapi.h"
+#include "pre_emptive_os/core/_oshal/api/a7hal.h"
+#include <printf_P.h>
+#include <framework.h>
+#include "./pool.h"
+
+#define ALIGNMENT 4
+
+static Pool *classes[POOL_MAX_CLASSES];
+static tU8 numClasses;
+
+static Pool smallPool;
+static Pool mediumPool;
+static Pool largePool;
+
+/*!
+ *  @brief    A function for carving a pool from the
+ *            heap and adding it to the size classes,
+ *            kept sorted by block size. Must be called
+ *            from process context.
+ *  @param pool
+ *            A pointer to the pool to initialize.
+ *  @param name
+ *            Name shown in the report.
+ *  @param blockSize
+ *            Size of a block in bytes, rounded up to
+ *            a multiple of 4.
+ *  @param numBlocks
+ *            Number of blocks.
+ *  @returns  true if the pool has been created, false
+ *            if the heap or the class table is full
+ */
+tBool
+poolInit(Pool *pool, const char *name, tU16 blockSize, tU16 numBlocks)
+{
+    volatile tSR localSR;
+    tU32 size;
+    tU8 *heap;
+    tU16 i;
+    tU8 index;
+
+    if (blockSize < sizeof(void *)) blockSize = sizeof(void *);
+    blockSize = (blockSize + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    size = (tU32)blockSize * numBlocks;
+
+    m_os_dis_int();
+    heap = (tU8 *)(((tU32)pHeapStart + ALIGNMENT - 1) & ~(ALIGNMENT - 1));
+    if (numClasses == POOL_MAX_CLASSES || numBlocks == 0 ||
+        heap + size > pHeapEnd)
+    {
+        m_os_ena_int();
+        return FALSE;
+    }
+    pHeapStart = heap + size;
+    m_os_ena_int();
+
+    pool->name = name;
+    pool->start = heap;
+    pool->end = heap + size;
+    pool->blockSize = blockSize;
+    pool->numBlocks = numBlocks;
+    pool->used = 0;
+    pool->highWater = 0;
+    pool->failures = 0;
+
+    // link the blocks in address order
+    for (i = 0; i < numBlocks - 1; i++)
+        *(void **)(heap + i * blockSize) = heap + (i + 1) * blockSize;
+    *(void **)(heap + i * blockSize) = NULL;
+    pool->freeList = heap;
+
+    m_os_dis_int();
+    index = numClasses;
+    while (index > 0 && classes[index - 1]->blockSize > blockSize)
+    {
+        classes[index] = classes[index - 1];
+        index--;
+    }
+    classes[index] = pool;
+    numClasses++;
+    m_os_ena_int();
+    return TRUE;
+}
+
+/*!
+ *  @brief    A function for taking a block from a pool.
+ *  @param pool
+ *            A pointer to an initialized pool.
+ *  @returns  a pointer to the block, or NULL if the
+ *            pool is exhausted
+ */
+void *
+poolAlloc(Pool *pool)
+{
+    volatile tSR localSR;
+    void *block;
+
+    m_os_dis_int();
+    block = pool->freeList;
+    if (block != NULL)
+    {
+        pool->freeList = *(void **)block;
+        if (++pool->used > pool->highWater) pool->highWater = pool->used;
+    }
+    else
+    {
+        pool->failures++;
+    }
+    m_os_ena_int();
+
+    return block;
+}
+
+/*!
+ *  @brief    A function for returning a block to its
+ *            pool. A pointer that is not the start of
+ *            a block of the pool, or a release with no
+ *            block taken, is rejected and the pool is
+ *            left unchanged.
+ *  @param pool
+ *            A pointer to the pool the block was
+ *            taken from.
+ *  @param block
+ *            A pointer to the block, NULL is ignored.
+ *  @returns  false if the block has been rejected
+ */
+tBool
+poolFree(Pool *pool, void *block)
+{
+    volatile tSR localSR;
+    tU8 *address = (tU8 *)block;
+
+    if (block == NULL) return TRUE;
+    if (address < pool->start || address >= pool->end ||
+        (tU32)(address - pool->start) % pool->blockSize != 0)
+        return FALSE;
+
+    m_os_dis_int();
+    if (pool->used == 0)
+    {
+        m_os_ena_int();
+        return FALSE;
+    }
+    *(void **)block = pool->freeList;
+    pool->freeList = block;
+    pool->used--;
+    m_os_ena_int();
+    return TRUE;
+}
+
+/*!
+ *  @brief    A function for creating the default size
+ *            classes of memAlloc. Classes created by an
+ *            earlier call are kept, so it may be called
+ *            by every user before allocating, from
+ *            process context.
+ *  @returns  true if all the classes exist, false if
+ *            the heap or the class table is full
+ */
+tBool
+memInit(void)
+{
+    tBool created = TRUE;
+
+    if (smallPool.start == NULL &&
+        poolInit(&smallPool, "small", MEM_SMALL_SIZE,
+                 MEM_SMALL_COUNT) == FALSE)
+        created = FALSE;
+    if (mediumPool.start == NULL &&
+        poolInit(&mediumPool, "medium", MEM_MEDIUM_SIZE,
+                 MEM_MEDIUM_COUNT) == FALSE)
+        created = FALSE;
+    if (largePool.start == NULL &&
+        poolInit(&largePool, "large", MEM_LARGE_SIZE,
+                 MEM_LARGE_COUNT) == FALSE)
+        created = FALSE;
+
+    if (created == FALSE) printf("pool: no heap for the memAlloc classes\n");
+    return created;
+}
+
+/*!
+ *  @brief    A function for taking a block of at least
+ *            the given size from the smallest size class
+ *            that has a free one.
+ *  @param size
+ *            Requested size in bytes.
+ *  @returns  a pointer to the block, or NULL if no
+ *            class can satisfy the request
+ */
+void *
+memAlloc(tU16 size)
+{
+    tU8 i;
+
+    for (i = 0; i < numClasses; i++)
+    {
+        void *block;
+
+        if (classes[i]->blockSize < size) continue;
+        block = poolAlloc(classes[i]);
+        if (block != NULL) return block;
+    }
+    return NULL;
+}
+
+/*!
+ *  @brief    A procedure for returning a block taken
+ *            with memAlloc. The pool is found from the
+ *            address of the block.
+ *  @param block
+ *            A pointer to the block, NULL is ignored.
+ */
+void
+memFree(void *block)
+{
+    tU8 i;
+
+    if (block == NULL) return;
+    for (i = 0; i < numClasses; i++)
+    {
+        Pool *pool = classes[i];
+        if ((tU8 *)block >= pool->start && (tU8 *)block < pool->end)
+        {
+            poolFree(pool, block);
+            return;
+        }
+    }
+}
+
+/*!
+ *  @brief    A function for reading the size of the
+ *            heap not yet taken by pools.
+ *  @returns  free heap in bytes
+ */
+tU32
+poolHeapLeft(void)
+{
+    return pHeapEnd > pHeapStart ? (tU32)(pHeapEnd - pHeapStart) : 0;
+}
+
+/*!
+ *  @brief    A procedure printing the usage of all
+ *            the pools.
+ */
+void
+poolReport(void)
+{
+    tU8 i;
+
+    printf("pool  block  used/total  peak  failed\n");
+    for (i = 0; i < numClasses; i++)
+    {
+        Pool *pool = classes[i];
+        printf("%s  %d  %d/%d  %d  %u\n", pool->name, pool->blockSize,
+               pool->used, pool->numBlocks, pool->highWater, pool->failures);
+    }
+    printf("heap left: %u bytes\n", poolHeapLeft());
+}
@@ -0,0 +1,55 @@
+/******************************************************************************
+ *
+ * Copyright:
+ *    Byczki(TM)
+ *
+ * File:
+ *    pool.h
+ *
+ * Description:
+ *    Expose public functions and types of the fixed-block memory pools.
+ *
+ *****************************************************************************/
+#ifndef _POOL_H_
+#define _POOL_H_
+
+#include <general.h>
+
+#define POOL_MAX_CLASSES 6
+
+// default size classes created by memInit
+#define MEM_SMALL_SIZE 16
+#define MEM_SMALL_COUNT 24
+#define MEM_MEDIUM_SIZE 64
+#define MEM_MEDIUM_COUNT 12
+#define MEM_LARGE_SIZE 256
+#define MEM_LARGE_COUNT 4
+
+/*
+ * A pool of equal blocks carved from the heap once. Free blocks are
+ * linked through their first word, so allocation and release take
+ * constant time.
+ */
+typedef struct Pool
+{
+    const char *name;
+    tU8 *start;
+    tU8 *end;
+    void *freeList;
+    tU16 blockSize;
+    tU16 numBlocks;
+    tU16 used;
+    tU16 highWater;
+    tU32 failures;
+} Pool;
+
+tBool poolInit(Pool *pool, const char *name, tU16 blockSize, tU16 numBlocks);
+void *poolAlloc(Pool *pool);
+tBool poolFree(Pool *pool, void *block);
+tBool memInit(void);
+void *memAlloc(tU16 size);
+void memFree(void *block);
+tU32 poolHeapLeft(void);
+void poolReport(void);
+
+#endif
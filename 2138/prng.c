@@ -0,0 +1,88 @@
+/******************************************************************************
+ *
+ * Copyright:
+ *    Byczki(TM)
+ *
+ * File:
+ *    prng.c
+ *
+ * Description:
+ *    Implement seeding of the xorshift pseudo-random number generator.
+ *
+ *****************************************************************************/
+
+#include <lpc2xxx.h>
+#include "./adc.h"
+#include "./prng.h"
+
+#define SEED_SAMPLES 32
+
+tU32 prngState = 2463534242u;
+
+/*!
+ *  @brief    A function for spreading the entropy of
+ *            the collected bits over the whole word
+ *            (murmur3 finalizer).
+ *  @param x
+ *            A value to mix.
+ *  @returns  the mixed value
+ */
+static tU32
+mix(tU32 x)
+{
+    x ^= x >> 16;
+    x *= 0x85EBCA6Bu;
+    x ^= x >> 13;
+    x *= 0xC2B2AE35u;
+    x ^= x >> 16;
+    return x;
+}
+
+/*!
+ *  @brief    A procedure for setting the generator seed.
+ *            The same seed always produces the same
+ *            sequence.
+ *  @param seed
+ *            A seed value, zero is replaced with
+ *            a non-zero constant since xorshift would
+ *            stay at zero forever.
+ */
+void
+prngSeed(tU32 seed)
+{
+    if (seed == 0) seed = 2463534242u;
+    prngState = seed;
+}
+
+/*!
+ *  @brief    A function for seeding the generator from
+ *            hardware noise: the least significant bits
+ *            of the accelerometer readings and the jitter
+ *            of Timer0 against the ADC conversion time.
+ *            The ADC must be initialized. If PRNG_FIXED_SEED
+ *            is set it is used instead.
+ *  @returns  the seed used, so a run can be replayed
+ *            with prngSeed
+ */
+tU32
+prngSeedFromHardware(void)
+{
+    tU32 seed = 0;
+#if PRNG_FIXED_SEED == 0
+    tU8 i;
+#endif
+
+#if PRNG_FIXED_SEED != 0
+    seed = PRNG_FIXED_SEED;
+#else
+    for (i = 0; i < SEED_SAMPLES; i++)
+    {
+        tU16 noise = getAnalogueInput1(ACCEL_X) ^ (getAnalogueInput1(ACCEL_Y) << 2);
+        seed = (seed << 3 | seed >> 29) ^ noise ^ T0TC;
+    }
+    seed = mix(seed);
+#endif
+
+    prngSeed(seed);
+    return prngState;
+}
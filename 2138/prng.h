@@ -0,0 +1,81 @@
+/******************************************************************************
+ *
+ * Copyright:
+ *    Byczki(TM)
+ *
+ * File:
+ *    prng.h
+ *
+ * Description:
+ *    Expose the xorshift pseudo-random number generator. The generator
+ *    functions are inline, so drawing a number costs a few shifts
+ *    instead of a library call.
+ *
+ *****************************************************************************/
+#ifndef _PRNG_H_
+#define _PRNG_H_
+
+#include <general.h>
+
+/*
+ * Set to a non-zero value to make every power-on use the same seed,
+ * e.g. for deterministic benchmark runs.
+ */
+#define PRNG_FIXED_SEED 0
+
+extern tU32 prngState;
+
+void prngSeed(tU32 seed);
+tU32 prngSeedFromHardware(void);
+
+/*!
+ *  @brief    A function for generating the next
+ *            pseudo-random value (xorshift32).
+ *  @returns  a pseudo-random 32-bit unsigned integer
+ */
+static inline tU32
+prngNext(void)
+{
+    tU32 x = prngState;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    prngState = x;
+    return x;
+}
+
+/*!
+ *  @brief    A function for generating a pseudo-random
+ *            value within a range, without the modulo bias.
+ *            Values are masked to the smallest covering
+ *            power of two and rejected if out of range,
+ *            which takes less than two draws on average.
+ *  @param minInc
+ *            Min value (inclusive)
+ *  @param maxInc
+ *            Max value (inclusive)
+ *  @returns  a pseudo-random 32-bit unsigned integer
+ *            ranging from minInc to maxInc
+ */
+static inline tU32
+prngRange(tU32 minInc, tU32 maxInc)
+{
+    tU32 range = maxInc - minInc;
+    tU32 mask = range;
+    tU32 value;
+
+    mask |= mask >> 1;
+    mask |= mask >> 2;
+    mask |= mask >> 4;
+    mask |= mask >> 8;
+    mask |= mask >> 16;
+
+    do
+    {
+        value = prngNext() & mask;
+    } while (value > range);
+
+    return minInc + value;
+}
+
+#endif
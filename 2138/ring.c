@@ -0,0 +1,222 @@
+/******************************************************************************
+ *
+ * Copyright:
+ *    Byczki(TM)
+ *
+ * File:
+ *    ring.c
+ *
+ * Description:
+ *    Implement single-producer, single-consumer ring buffers for
+ *    handing data from an interrupt to a process, or between two
+ *    processes. Push and pop are wait-free and never mask interrupts:
+ *    the producer only stores head and the consumer only stores tail,
+ *    a single word store each, and the ARM7 core neither reorders
+ *    memory accesses nor caches data. Only the compiler has to be kept
+ *    from moving the element copy past the index update.
+ *
+ *    The ring itself may be used from the FIQ. The channel wrapper
+ *    gives a semaphore on push, so its producer must run in a process
+ *    or an IRQ entered through the OS.
+ *
+ *****************************************************************************/
+
+#include "./ring.h"
+
+#define BARRIER() __asm__ __volatile__("" : : : "memory")
+
+/*!
+ *  @brief    A procedure for copying an element, a word
+ *            at a time when it is a single word.
+ *  @param to
+ *            Destination of the copy.
+ *  @param from
+ *            Source of the copy.
+ *  @param size
+ *            Size of the element in bytes.
+ */
+static void
+copyElem(void *to, const void *from, tU16 size)
+{
+    tU8 *dst = to;
+    const tU8 *src = from;
+
+    if (size == sizeof(tU32) && (((tU32)dst | (tU32)src) & 3) == 0)
+    {
+        *(tU32 *)dst = *(const tU32 *)src;
+        return;
+    }
+    while (size-- > 0)
+        *dst++ = *src++;
+}
+
+/*!
+ *  @brief    A function for initializing an empty ring.
+ *  @param ring
+ *            A pointer to the ring to initialize.
+ *  @param buffer
+ *            Storage of capacity * elemSize bytes, word
+ *            aligned, see RING_STORAGE.
+ *  @param elemSize
+ *            Size of an element in bytes.
+ *  @param capacity
+ *            Number of elements, a power of two.
+ *  @returns  false if capacity is not a power of two
+ */
+tBool
+ringInit(Ring *ring, void *buffer, tU16 elemSize, tU16 capacity)
+{
+    if (capacity == 0 || (capacity & (capacity - 1)) != 0) return FALSE;
+
+    ring->buffer = buffer;
+    ring->elemSize = elemSize;
+    ring->mask = capacity - 1;
+    ring->head = 0;
+    ring->tail = 0;
+    ring->dropped = 0;
+    return TRUE;
+}
+
+/*!
+ *  @brief    A function for appending an element. Must
+ *            only be called by the producer.
+ *  @param ring
+ *            A pointer to an initialized ring.
+ *  @param elem
+ *            A pointer to the element to copy in.
+ *  @returns  false if the ring is full, the element
+ *            is then counted as dropped
+ */
+tBool
+ringPush(Ring *ring, const void *elem)
+{
+    tU32 head = ring->head;
+
+    if (head - ring->tail > ring->mask)
+    {
+        ring->dropped++;
+        return FALSE;
+    }
+
+    copyElem(&ring->buffer[(head & ring->mask) * ring->elemSize], elem, ring->elemSize);
+    BARRIER();
+    ring->head = head + 1;
+    return TRUE;
+}
+
+/*!
+ *  @brief    A function for taking the oldest element.
+ *            Must only be called by the consumer.
+ *  @param ring
+ *            A pointer to an initialized ring.
+ *  @param elem
+ *            Returns a copy of the element.
+ *  @returns  false if the ring is empty
+ */
+tBool
+ringPop(Ring *ring, void *elem)
+{
+    tU32 tail = ring->tail;
+
+    if (tail == ring->head) return FALSE;
+
+    copyElem(elem, &ring->buffer[(tail & ring->mask) * ring->elemSize], ring->elemSize);
+    BARRIER();
+    ring->tail = tail + 1;
+    return TRUE;
+}
+
+/*!
+ *  @brief    A function for reading the number of
+ *            stored elements.
+ *  @param ring
+ *            A pointer to an initialized ring.
+ *  @returns  number of elements, a snapshot which
+ *            may be stale for the other side
+ */
+tU16
+ringCount(const Ring *ring)
+{
+    return (tU16)(ring->head - ring->tail);
+}
+
+/*!
+ *  @brief    A function for initializing an empty
+ *            channel.
+ *  @param channel
+ *            A pointer to the channel to initialize.
+ *  @param buffer
+ *            Storage of the ring, see ringInit.
+ *  @param elemSize
+ *            Size of an element in bytes.
+ *  @param capacity
+ *            Number of elements, a power of two.
+ *  @returns  false if capacity is not a power of two
+ */
+tBool
+ringChannelInit(RingChannel *channel, void *buffer, tU16 elemSize, tU16 capacity)
+{
+    osSemInit(&channel->items, 0);
+    return ringInit(&channel->ring, buffer, elemSize, capacity);
+}
+
+/*!
+ *  @brief    A function for appending an element and
+ *            waking the consumer. Must only be called by
+ *            the producer, from a process or an IRQ.
+ *  @param channel
+ *            A pointer to an initialized channel.
+ *  @param elem
+ *            A pointer to the element to copy in.
+ *  @returns  false if the ring is full
+ */
+tBool
+ringChannelPush(RingChannel *channel, const void *elem)
+{
+    tU8 error;
+
+    if (ringPush(&channel->ring, elem) == FALSE) return FALSE;
+    osSemGive(&channel->items, &error);
+    return TRUE;
+}
+
+/*!
+ *  @brief    A function for waiting for the oldest
+ *            element. Must only be called by the
+ *            consumer process.
+ *  @param channel
+ *            A pointer to an initialized channel.
+ *  @param elem
+ *            Returns a copy of the element.
+ *  @param timeout
+ *            Number of ticks to wait, zero means wait
+ *            forever.
+ *  @returns  false on timeout
+ */
+tBool
+ringChannelPop(RingChannel *channel, void *elem, tU32 timeout)
+{
+    tU8 error;
+
+    if (osSemTake(&channel->items, timeout, &error) == FALSE) return FALSE;
+    return ringPop(&channel->ring, elem);
+}
+
+/*!
+ *  @brief    A function for taking the oldest element
+ *            without blocking. Must only be called by the
+ *            consumer.
+ *  @param channel
+ *            A pointer to an initialized channel.
+ *  @param elem
+ *            Returns a copy of the element.
+ *  @returns  false if the channel is empty
+ */
+tBool
+ringChannelTryPop(RingChannel *channel, void *elem)
+{
+    tU8 error;
+
+    if (osSemTryTake(&channel->items, &error) != 0) return FALSE;
+    return ringPop(&channel->ring, elem);
+}
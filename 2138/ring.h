@@ -0,0 +1,62 @@
+/******************************************************************************
+ *
+ * Copyright:
+ *    Byczki(TM)
+ *
+ * File:
+ *    ring.h
+ *
+ * Description:
+ *    Expose public functions and types of the single-producer,
+ *    single-consumer ring buffers.
+ *
+ *****************************************************************************/
+#ifndef _RING_H_
+#define _RING_H_
+
+#include "pre_emptive_os/api/osapi.h"
+#include <general.h>
+
+/*
+ * Declares word-aligned storage for a ring of capacity elements of
+ * elemSize bytes each.
+ */
+#define RING_STORAGE(name, capacity, elemSize) \
+    tU32 name[((capacity) * (elemSize) + 3) / 4]
+
+/*
+ * Only the producer writes head and only the consumer writes tail.
+ * Both count up freely and are masked on access, so head - tail is
+ * the number of stored elements even after they wrap.
+ */
+typedef struct Ring
+{
+    tU8 *buffer;
+    tU16 elemSize;
+    tU16 mask;
+    volatile tU32 head;
+    volatile tU32 tail;
+    volatile tU32 dropped;
+} Ring;
+
+/*
+ * A ring with a counting semaphore of stored elements, so that the
+ * consumer process can block until the producer pushes.
+ */
+typedef struct RingChannel
+{
+    Ring ring;
+    tCntSem items;
+} RingChannel;
+
+tBool ringInit(Ring *ring, void *buffer, tU16 elemSize, tU16 capacity);
+tBool ringPush(Ring *ring, const void *elem);
+tBool ringPop(Ring *ring, void *elem);
+tU16 ringCount(const Ring *ring);
+
+tBool ringChannelInit(RingChannel *channel, void *buffer, tU16 elemSize, tU16 capacity);
+tBool ringChannelPush(RingChannel *channel, const void *elem);
+tBool ringChannelPop(RingChannel *channel, void *elem, tU32 timeout);
+tBool ringChannelTryPop(RingChannel *channel, void *elem);
+
+#endif
@@ -0,0 +1,158 @@
+/******************************************************************************
+ *
+ * Copyright:
+ *    Byczki(TM)
+ *
+ * File:
+ *    sampler.c
+ *
+ * Description:
+ *    Implement the FIQ-driven accelerometer sampler. A Timer1 match
+ *    raises a FIQ at twice SAMPLER_RATE_HZ, and each FIQ converts
+ *    AIN6 and AIN7 in turn. The samples are summed, so a read
+ *    returns the average of all the samples since the previous read.
+ *    The control processes get jitter-free, oversampled input and
+ *    never wait for a conversion.
+ *
+ *    Timer1 keeps running freely as the time base of systime.c, the
+ *    sampler only uses its MR1 match.
+ *
+ *****************************************************************************/
+
+#include "pre_emptive_os/api/osapi.h"
+#include <lpc2xxx.h>
+#include <framework.h>
+#include "./adc.h"
+#include "./irq.h"
+#include "./sampler.h"
+
+#define TIMER1_BIT (1ul << IRQ_SOURCE_TIMER1)
+#define MCR_MR1_INTERRUPT (1 << 3)
+#define T1IR_MR1 0x02
+
+extern void samplerFiq(void);
+
+static volatile tBool running = FALSE;
+
+/*!
+ *  @brief    A function for converting an ADC channel
+ *            to the index of its axis.
+ *  @returns  0 for ACCEL_X, 1 for ACCEL_Y
+ */
+static tU8
+axisOf(tU8 channel)
+{
+    return channel == ACCEL_Y ? 1 : 0;
+}
+
+/*!
+ *  @brief    A function for starting the sampler. The
+ *            ADC must be initialized. Does nothing if
+ *            SAMPLER_RATE_HZ is 0.
+ *  @returns  true if the sampler is running
+ */
+tBool
+samplerStart(void)
+{
+    tU8 i;
+
+    if (SAMPLER_RATE_HZ == 0) return FALSE;
+    if (running) return TRUE;
+    if (VICIntEnable & TIMER1_BIT) return FALSE;
+
+    for (i = 0; i < 2; i++)
+    {
+        samplerState.sum[i] = 0;
+        samplerState.count[i] = 0;
+        samplerState.last[i] = getAnalogueInput1(i == 0 ? ACCEL_X : ACCEL_Y);
+    }
+    samplerState.period = PCLK / (2 * SAMPLER_RATE_HZ);
+
+    // the first match reads ACCEL_X
+    samplerState.channel = 0;
+    AD1CR = (AD1CR & 0xF8FFFF00) | (1 << ACCEL_X) | (1 << 24);
+
+    pISR_FIQ = (unsigned int)samplerFiq;
+    T1MR1 = T1TC + samplerState.period;
+    T1IR = T1IR_MR1;
+    T1MCR |= MCR_MR1_INTERRUPT;
+    VICIntSelect |= TIMER1_BIT;
+    running = TRUE;
+    VICIntEnable = TIMER1_BIT;
+    return TRUE;
+}
+
+/*!
+ *  @brief    A procedure for stopping the sampler. The
+ *            ADC may be read on demand again afterwards.
+ */
+void
+samplerStop(void)
+{
+    if (running == FALSE) return;
+
+    VICIntEnClr = TIMER1_BIT;
+    VICIntSelect &= ~TIMER1_BIT;
+    T1MCR &= ~MCR_MR1_INTERRUPT;
+    T1IR = T1IR_MR1;
+    running = FALSE;
+
+    // let the conversion started by the last FIQ finish
+    while ((AD1DR & 0x80000000) == 0)
+        ;
+}
+
+/*!
+ *  @brief    A function checking if the sampler runs.
+ *  @returns  true if the sampler is running
+ */
+tBool
+samplerIsRunning(void)
+{
+    return running;
+}
+
+/*!
+ *  @brief    A function for reading an axis of the
+ *            accelerometer. While the sampler runs it
+ *            returns the average of the samples since
+ *            the previous read of the axis, otherwise
+ *            a single conversion is made. The sums
+ *            overflow after about an hour without reads.
+ *  @param channel
+ *            ACCEL_X or ACCEL_Y.
+ *  @returns  10-bit value of the axis
+ */
+tU16
+samplerRead(tU8 channel)
+{
+    tU8 axis = axisOf(channel);
+    tU32 sum;
+    tU32 count;
+
+    if (running == FALSE) return getAnalogueInput1(channel);
+
+    // mask the FIQ at the VIC, a pending match fires right after
+    VICIntEnClr = TIMER1_BIT;
+    sum = samplerState.sum[axis];
+    count = samplerState.count[axis];
+    samplerState.sum[axis] = 0;
+    samplerState.count[axis] = 0;
+    VICIntEnable = TIMER1_BIT;
+
+    if (count == 0) return (tU16)samplerState.last[axis];
+    return (tU16)((sum + count / 2) / count);
+}
+
+/*!
+ *  @brief    A function for reading the latest sample
+ *            of an axis without taking it from the sums.
+ *  @param channel
+ *            ACCEL_X or ACCEL_Y.
+ *  @returns  10-bit value of the axis
+ */
+tU16
+samplerLast(tU8 channel)
+{
+    return (tU16)samplerState.last[axisOf(channel)];
+}
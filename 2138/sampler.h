@@ -0,0 +1,45 @@
+/******************************************************************************
+ *
+ * Copyright:
+ *    Byczki(TM)
+ *
+ * File:
+ *    sampler.h
+ *
+ * Description:
+ *    Expose public functions and defines of the accelerometer sampler.
+ *
+ *****************************************************************************/
+#ifndef _SAMPLER_H_
+#define _SAMPLER_H_
+
+#include <general.h>
+
+/*
+ * Rate of the FIQ sampler in samples per second and axis. Set to 0
+ * to read the accelerometer on demand instead.
+ */
+#define SAMPLER_RATE_HZ 1000
+
+/*
+ * State shared with the FIQ handler in sampler_fiq.S, which relies
+ * on this exact layout. Index 0 is ACCEL_X, index 1 ACCEL_Y.
+ */
+typedef struct SamplerState
+{
+    tU32 sum[2];        /* sum of the samples since the last read */
+    tU32 count[2];      /* number of samples in the sums */
+    tU32 last[2];       /* latest samples */
+    tU32 period;        /* timer cycles between matches */
+    tU32 channel;       /* axis being converted */
+} SamplerState;
+
+extern volatile SamplerState samplerState;
+
+tBool samplerStart(void);
+void samplerStop(void);
+tBool samplerIsRunning(void);
+tU16 samplerRead(tU8 channel);
+tU16 samplerLast(tU8 channel);
+
+#endif
@@ -0,0 +1,242 @@
+/******************************************************************************
+ *
+ * Copyright:
+ *    Byczki(TM)
+ *
+ * File:
+ *    sprite.c
+ *
+ * Description:
+ *    Implement colour-keyed sprites composited over the background.
+ *    A moving sprite rewrites only the union of its old and new
+ *    bounding boxes, so it costs no more bus bandwidth than the
+ *    erase-and-draw of a solid rectangle.
+ *
+ *****************************************************************************/
+
+#include "pre_emptive_os/api/osapi.h"
+#include "./lcd.h"
+#include "./sprite.h"
+
+static tU8 solidBackground(tU8 x, tU8 y);
+
+static tU8 (*getBackgroundPixel)(tU8 x, tU8 y) = solidBackground;
+
+/*!
+ *  @brief    Default background provider, a plain
+ *            black playfield.
+ *  @param x
+ *            Screen x-coordinate of the pixel.
+ *  @param y
+ *            Screen y-coordinate of the pixel.
+ *  @returns  colour of the background pixel
+ */
+static tU8
+solidBackground(tU8 x, tU8 y)
+{
+    return BLACK;
+}
+
+/*!
+ *  @brief    A procedure for streaming a rectangular
+ *            area of the screen, compositing the sprite
+ *            (if visible) over the background. The whole
+ *            area is sent in a single window write.
+ *  @param sprite
+ *            A pointer to the sprite to composite.
+ *  @param x
+ *            Left edge of the area.
+ *  @param y
+ *            Top edge of the area.
+ *  @param xLen
+ *            Width of the area.
+ *  @param yLen
+ *            Height of the area.
+ */
+static void
+composeRect(Sprite *sprite, tU8 x, tU8 y, tU8 xLen, tU8 yLen)
+{
+    const SpriteImage *image = sprite->image;
+    tU8 row;
+    tU8 col;
+
+    lcdStartWrite(x, y, xLen, yLen);
+    for (row = y; row < y + yLen; row++)
+    {
+        tU8 spanStart = 0;
+        tU8 spanEnd = 0;
+        const tU8 *pixels = NULL;
+
+        if (sprite->visible &&
+            row >= sprite->yPos && row < sprite->yPos + image->height)
+        {
+            tU8 imageRow = row - sprite->yPos;
+            spanStart = sprite->xPos + sprite->spans[imageRow].start;
+            spanEnd = sprite->xPos + sprite->spans[imageRow].end;
+            pixels = &image->pixels[imageRow * image->width];
+        }
+
+        for (col = x; col < x + xLen; col++)
+        {
+            if (col >= spanStart && col < spanEnd)
+            {
+                tU8 pixel = pixels[col - sprite->xPos];
+                if (pixel != image->colorKey)
+                {
+                    lcdWrdata(pixel);
+                    continue;
+                }
+            }
+            lcdWrdata(getBackgroundPixel(col, row));
+        }
+    }
+    lcdEndWrite();
+}
+
+/*!
+ *  @brief    A procedure for setting the function used
+ *            to read the background under transparent
+ *            and uncovered sprite pixels.
+ *  @param backgroundPixel
+ *            A function returning the colour of all the
+ *            layers below the sprites at the given screen
+ *            position, or NULL to use a plain black
+ *            background.
+ */
+void
+spriteSetBackground(tU8 (*backgroundPixel)(tU8 x, tU8 y))
+{
+    if (backgroundPixel == NULL) backgroundPixel = solidBackground;
+    getBackgroundPixel = backgroundPixel;
+}
+
+/*!
+ *  @brief    A procedure for initializing a sprite and
+ *            decoding the opaque span of every image row.
+ *            The sprite is initially hidden.
+ *  @param sprite
+ *            A pointer to the sprite to initialize.
+ *  @param image
+ *            A pointer to the flash-resident image,
+ *            at most SPRITE_MAX_HEIGHT rows high.
+ */
+void
+spriteInit(Sprite *sprite, const SpriteImage *image)
+{
+    tU8 row;
+    tU8 col;
+
+    sprite->image = image;
+    sprite->xPos = 0;
+    sprite->yPos = 0;
+    sprite->visible = FALSE;
+
+    for (row = 0; row < image->height && row < SPRITE_MAX_HEIGHT; row++)
+    {
+        const tU8 *pixels = &image->pixels[row * image->width];
+        tU8 start = image->width;
+        tU8 end = 0;
+        for (col = 0; col < image->width; col++)
+        {
+            if (pixels[col] == image->colorKey) continue;
+            if (col < start) start = col;
+            end = col + 1;
+        }
+        if (end == 0) start = 0;
+
+        sprite->spans[row].start = start;
+        sprite->spans[row].end = end;
+    }
+}
+
+/*!
+ *  @brief    A procedure for placing a hidden sprite
+ *            on the screen.
+ *  @param sprite
+ *            A pointer to an initialized sprite.
+ *  @param x
+ *            Screen x-coordinate of the top-left corner.
+ *  @param y
+ *            Screen y-coordinate of the top-left corner.
+ */
+void
+spriteShow(Sprite *sprite, tU8 x, tU8 y)
+{
+    sprite->xPos = x;
+    sprite->yPos = y;
+    sprite->visible = TRUE;
+    spriteRedraw(sprite);
+}
+
+/*!
+ *  @brief    A procedure for moving a visible sprite.
+ *            When the old and the new bounding boxes
+ *            overlap only their union is rewritten,
+ *            otherwise the two boxes are rewritten
+ *            separately.
+ *  @param sprite
+ *            A pointer to a visible sprite.
+ *  @param x
+ *            New screen x-coordinate of the top-left corner.
+ *  @param y
+ *            New screen y-coordinate of the top-left corner.
+ */
+void
+spriteMove(Sprite *sprite, tU8 x, tU8 y)
+{
+    tU8 width = sprite->image->width;
+    tU8 height = sprite->image->height;
+    tU8 oldX = sprite->xPos;
+    tU8 oldY = sprite->yPos;
+
+    if (sprite->visible == FALSE || (x == oldX && y == oldY)) return;
+
+    sprite->xPos = x;
+    sprite->yPos = y;
+
+    if (x + width <= oldX || oldX + width <= x ||
+        y + height <= oldY || oldY + height <= y)
+    {
+        composeRect(sprite, oldX, oldY, width, height);
+        composeRect(sprite, x, y, width, height);
+        return;
+    }
+
+    {
+        tU8 left = x < oldX ? x : oldX;
+        tU8 top = y < oldY ? y : oldY;
+        tU8 right = (x > oldX ? x : oldX) + width;
+        tU8 bottom = (y > oldY ? y : oldY) + height;
+        composeRect(sprite, left, top, right - left, bottom - top);
+    }
+}
+
+/*!
+ *  @brief    A procedure for removing a sprite from
+ *            the screen and restoring the background.
+ *  @param sprite
+ *            A pointer to the sprite to hide.
+ */
+void
+spriteHide(Sprite *sprite)
+{
+    if (sprite->visible == FALSE) return;
+    sprite->visible = FALSE;
+    composeRect(sprite, sprite->xPos, sprite->yPos,
+                sprite->image->width, sprite->image->height);
+}
+
+/*!
+ *  @brief    A procedure for redrawing a visible sprite
+ *            in place, e.g. after something was painted
+ *            over it.
+ *  @param sprite
+ *            A pointer to the sprite to redraw.
+ */
+void
+spriteRedraw(Sprite *sprite)
+{
+    if (sprite->visible == FALSE) return;
+    composeRect(sprite, sprite->xPos, sprite->yPos,
+                sprite->image->width, sprite->image->height);
+}
@@ -0,0 +1,66 @@
+/******************************************************************************
+ *
+ * Copyright:
+ *    Byczki(TM)
+ *
+ * File:
+ *    sprite.h
+ *
+ * Description:
+ *    Expose public functions and types of the colour-keyed sprites.
+ *
+ *****************************************************************************/
+#ifndef _SPRITE_H_
+#define _SPRITE_H_
+
+#include <general.h>
+
+#define SPRITE_MAX_HEIGHT 16
+#define SPRITE_KEY (tU8)0xE3u
+
+/*
+ * Sprite bitmap kept in flash. Pixels are stored row by row in
+ * RRRGGGBB format, pixels equal to colorKey are transparent.
+ */
+typedef struct SpriteImage
+{
+    tU8 width;
+    tU8 height;
+    tU8 colorKey;
+    const tU8 *pixels;
+} SpriteImage;
+
+/*
+ * Opaque extent of a single sprite row, decoded once in spriteInit.
+ * An empty row has start equal to end.
+ */
+typedef struct SpriteSpan
+{
+    tU8 start;
+    tU8 end;
+} SpriteSpan;
+
+typedef struct Sprite
+{
+    const SpriteImage *image;
+    SpriteSpan spans[SPRITE_MAX_HEIGHT];
+    tU8 xPos;
+    tU8 yPos;
+    tBool visible;
+} Sprite;
+
+/*
+ * The background function must return the colour of everything
+ * drawn below the sprites, not only of one layer: the compositor
+ * repaints the whole box of a sprite with it wherever the sprite is
+ * transparent or has moved away. A game with more layers, e.g. tiles
+ * and obstacles, registers a function that combines them.
+ */
+void spriteSetBackground(tU8 (*backgroundPixel)(tU8 x, tU8 y));
+void spriteInit(Sprite *sprite, const SpriteImage *image);
+void spriteShow(Sprite *sprite, tU8 x, tU8 y);
+void spriteMove(Sprite *sprite, tU8 x, tU8 y);
+void spriteHide(Sprite *sprite);
+void spriteRedraw(Sprite *sprite);
+
+#endif
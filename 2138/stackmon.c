@@ -0,0 +1,281 @@
+/******************************************************************************
+ *
+ * Copyright:
+ *    Byczki(TM)
+ *
+ * File:
+ *    stackmon.c
+ *
+ * Description:
+ *    Implement the stack high-water monitor. Process stacks are
+ *    measured with osStackUsage, the exception mode stacks set up
+ *    by startup.S are filled with the OS stack pattern at boot and
+ *    measured with checkStackLimit. The peak of every stack area is
+ *    kept across process restarts and reported together with a
+ *    recommended size.
+ *
+ *****************************************************************************/
+
+#include "pre_emptive_os/core/kernel.h"
+#include "pre_emptive_os/core/pcb.h"
+#include "pre_emptive_os/core/stack_usage.h"
+#include <printf_P.h>
+#include "startup/config.h"
+#include "./systime.h"
+#include "./stackmon.h"
+
+#define NO_PID 0xff
+
+/* layout of the exception mode stacks, see startup.S */
+#define UND_STACK_TOP SRAM_TOP
+#define ABT_STACK_TOP (UND_STACK_TOP - stackSize_UND)
+#define FIQ_STACK_TOP (ABT_STACK_TOP - stackSize_ABT)
+#define IRQ_STACK_TOP (FIQ_STACK_TOP - stackSize_FIQ)
+#define SVC_STACK_TOP (IRQ_STACK_TOP - stackSize_IRQ)
+#define SYS_STACK_TOP (SVC_STACK_TOP - stackSize_SVC)
+
+/*
+ * A monitored stack area. Exception mode stacks have no pid,
+ * process stacks are recognized by their stack array, so the
+ * peak survives the process being deleted and created again.
+ */
+typedef struct StackArea
+{
+    const char *name;
+    tU8 *stack;
+    tU16 size;
+    tU8 pid;
+    tU8 peak;
+    tU8 loggedPeak;
+} StackArea;
+
+static StackArea areas[STACKMON_MAX_AREAS];
+static tU8 numAreas;
+static tU32 lastLogMs;
+
+/*!
+ *  @brief    A procedure for adding a stack area to
+ *            the monitored set.
+ *  @param name
+ *            Name printed in the report.
+ *  @param stack
+ *            Lowest address of the stack area.
+ *  @param size
+ *            Size of the stack area in bytes.
+ *  @param pid
+ *            Owning process or NO_PID.
+ */
+static void
+addArea(const char *name, tU8 *stack, tU16 size, tU8 pid)
+{
+    tU8 i;
+
+    for (i = 0; i < numAreas; i++)
+    {
+        if (areas[i].stack == stack)
+        {
+            areas[i].pid = pid;
+            return;
+        }
+    }
+    if (numAreas == STACKMON_MAX_AREAS) return;
+
+    areas[numAreas].name = name;
+    areas[numAreas].stack = stack;
+    areas[numAreas].size = size;
+    areas[numAreas].pid = pid;
+    areas[numAreas].peak = 0;
+    areas[numAreas].loggedPeak = 0;
+    numAreas++;
+}
+
+/*!
+ *  @brief    A function for measuring an area filled
+ *            with the stack pattern, to the nearest percent.
+ *  @param area
+ *            A pointer to the monitored area.
+ *  @returns  used fraction of the area in percent
+ */
+static tU8
+patternUsage(const StackArea *area)
+{
+    tU8 low = 0;
+    tU8 high = 100;
+
+    // smallest limit the stack has not grown past
+    while (low < high)
+    {
+        tU8 mid = (low + high) / 2;
+        if (checkStackLimit(area->stack, area->size, mid)) low = mid + 1;
+        else high = mid;
+    }
+    return low;
+}
+
+/*!
+ *  @brief    A function checking if a pid still refers
+ *            to the process owning the given stack area.
+ *  @param area
+ *            A pointer to the monitored area.
+ *  @returns  true if the owning process is alive
+ */
+static tBool
+isOwnerAlive(const StackArea *area)
+{
+    tU8 i;
+
+    for (i = 0; i < MAX_NUM_PROC; i++)
+    {
+        tOSPCB *pcb = &processControlBlocks[i];
+        if (pcb->pid != area->pid) continue;
+        if (pcb->flag == 0 || (pcb->flag & PROC_ENDED)) return FALSE;
+
+        return pcb->pStkOrg >= area->stack && pcb->pStkOrg <= area->stack + area->size;
+    }
+    return FALSE;
+}
+
+/*!
+ *  @brief    A function for calculating the recommended
+ *            size of a stack area from its peak usage.
+ *  @param area
+ *            A pointer to the monitored area.
+ *  @returns  recommended size in bytes, a multiple of 8
+ */
+static tU16
+recommendedSize(const StackArea *area)
+{
+    tU32 peakBytes = ((tU32)area->size * area->peak + 99) / 100;
+    tU32 margin = peakBytes * STACKMON_MARGIN_PERCENT / 100;
+
+    if (margin < STACKMON_MIN_MARGIN) margin = STACKMON_MIN_MARGIN;
+    return (tU16)((peakBytes + margin + 7) & ~7ul);
+}
+
+/*!
+ *  @brief    A procedure for filling the exception mode
+ *            stacks with the stack pattern. Must be called
+ *            from main before the OS is started, i.e. while
+ *            no interrupt uses its stack. The system stack
+ *            is filled only below the caller's frame.
+ */
+void
+stackMonInit(void)
+{
+    tU8 here;
+    tU8 *sysStack = (tU8 *)(SYS_STACK_TOP - stackSize_SYS);
+    tU16 sysFree = (tU16)(&here - sysStack) - 64;
+
+    numAreas = 0;
+    addArea("UND", (tU8 *)ABT_STACK_TOP, stackSize_UND, NO_PID);
+    addArea("ABT", (tU8 *)FIQ_STACK_TOP, stackSize_ABT, NO_PID);
+    addArea("FIQ", (tU8 *)IRQ_STACK_TOP, stackSize_FIQ, NO_PID);
+    addArea("IRQ", (tU8 *)SVC_STACK_TOP, stackSize_IRQ, NO_PID);
+    addArea("SVC", (tU8 *)SYS_STACK_TOP, stackSize_SVC, NO_PID);
+    addArea("SYS", sysStack, stackSize_SYS, NO_PID);
+
+    createStackPattern((tU8 *)(SYS_STACK_TOP), SRAM_TOP - SYS_STACK_TOP);
+    createStackPattern(sysStack, sysFree);
+}
+
+/*!
+ *  @brief    A procedure for adding the stack of
+ *            a newly created process to the monitored set.
+ *            Calling it again for the same stack array
+ *            keeps the peak of the previous run.
+ *  @param name
+ *            Name printed in the report.
+ *  @param pid
+ *            Process identification descriptor.
+ *  @param stack
+ *            The stack array passed to osCreateProcess.
+ *  @param size
+ *            Size of the stack array in bytes.
+ */
+void
+stackMonAddProcess(const char *name, tU8 pid, tU8 *stack, tU16 size)
+{
+    addArea(name, stack, size, pid);
+}
+
+/*!
+ *  @brief    A procedure for updating the peak usage
+ *            of every monitored area. Must be called
+ *            from a process.
+ */
+void
+stackMonSample(void)
+{
+    tU8 i;
+
+    for (i = 0; i < numAreas; i++)
+    {
+        StackArea *area = &areas[i];
+        tU8 usage;
+
+        if (area->pid == NO_PID) usage = patternUsage(area);
+        else if (isOwnerAlive(area)) usage = osStackUsage(area->pid);
+        else continue;
+
+        if (usage > area->peak) area->peak = usage;
+    }
+}
+
+/*!
+ *  @brief    A procedure for a soak run, to be called
+ *            regularly from a process loop. Every
+ *            STACKMON_LOG_PERIOD_MS it samples all areas
+ *            and logs the ones whose peak has grown.
+ */
+void
+stackMonPoll(void)
+{
+    tU32 now = timeNowMs();
+    tU8 i;
+
+    if (now - lastLogMs < STACKMON_LOG_PERIOD_MS) return;
+    lastLogMs = now;
+
+    stackMonSample();
+    for (i = 0; i < numAreas; i++)
+    {
+        StackArea *area = &areas[i];
+        if (area->peak <= area->loggedPeak) continue;
+
+        printf("stack %s peak %d%% of %d at %d ms\n",
+               area->name, area->peak, area->size, now);
+        area->loggedPeak = area->peak;
+    }
+}
+
+/*!
+ *  @brief    A procedure for printing the peak usage
+ *            and the recommended size of every monitored
+ *            stack area, together with the RAM that
+ *            would be reclaimed.
+ */
+void
+stackMonReport(void)
+{
+    tU32 reclaim = 0;
+    tU8 i;
+
+    stackMonSample();
+
+    printf("\nstack  size  peak%%  recommended\n");
+    for (i = 0; i < numAreas; i++)
+    {
+        StackArea *area = &areas[i];
+        tU16 recommended = recommendedSize(area);
+
+        // an area that has not been measured yet gives no advice
+        if (area->peak == 0)
+        {
+            printf("%s  %d  -  -\n", area->name, area->size);
+            continue;
+        }
+        printf("%s  %d  %d  %d\n", area->name, area->size, area->peak, recommended);
+        if (recommended < area->size) reclaim += area->size - recommended;
+    }
+    printf("reclaimable: %d bytes\n", reclaim);
+}
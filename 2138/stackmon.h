@@ -0,0 +1,31 @@
+/******************************************************************************
+ *
+ * Copyright:
+ *    Byczki(TM)
+ *
+ * File:
+ *    stackmon.h
+ *
+ * Description:
+ *    Expose the stack high-water monitor.
+ *
+ *****************************************************************************/
+#ifndef _STACKMON_H_
+#define _STACKMON_H_
+
+#include <general.h>
+
+#define STACKMON_MAX_AREAS 16
+#define STACKMON_LOG_PERIOD_MS 5000
+
+/* recommended size is the peak plus this margin, in percent of the peak */
+#define STACKMON_MARGIN_PERCENT 25
+#define STACKMON_MIN_MARGIN 32
+
+void stackMonInit(void);
+void stackMonAddProcess(const char *name, tU8 pid, tU8 *stack, tU16 size);
+void stackMonSample(void);
+void stackMonPoll(void);
+void stackMonReport(void);
+
+#endif
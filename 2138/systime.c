@@ -0,0 +1,181 @@
+/******************************************************************************
+ *
+ * Copyright:
+ *    Byczki(TM)
+ *
+ * File:
+ *    systime.c
+ *
+ * Description:
+ *    Implement the time base. Timer #1 counts peripheral clock cycles
+ *    without ever being reset and is extended to 64 bits in software,
+ *    so all times are derived from the crystal and do not drift with
+ *    the OS tick rate or with scheduling.
+ *
+ *****************************************************************************/
+
+#include "pre_emptive_os/api/osapi.h"
+#include "pre_emptive_os/core/_oshal/api/a7hal.h"
+#include <lpc2xxx.h>
+#include <framework.h>
+#include "./systime.h"
+
+#if (PCLK % 1000) != 0
+#error The time base needs a peripheral clock that is a whole number of kHz
+#endif
+
+#define CYCLES_PER_MS (PCLK / 1000)
+
+static volatile tU32 cyclesHigh;
+static volatile tU32 lastCycles;
+static volatile tU32 tickMs = 10;
+
+/*!
+ *  @brief    A procedure for starting the free-running
+ *            timer. Must be called before any other
+ *            function of the time base.
+ */
+void
+timeInit(void)
+{
+    T1TCR = 0x02;          // stop and reset timer
+    T1PR  = 0x00;          // count every peripheral clock cycle
+    T1MCR = 0x00;          // no action on match, never reset
+    T1IR  = 0xff;          // reset all interrupt flags
+    T1TCR = 0x01;          // start timer
+
+    cyclesHigh = 0;
+    lastCycles = 0;
+}
+
+/*!
+ *  @brief    A procedure to be called from the OS tick.
+ *            It keeps the 64-bit extension of the timer
+ *            up to date (the counter wraps every ~70 s)
+ *            and records the tick length.
+ *  @param elapsedMs
+ *            The number of milliseconds since the last tick.
+ */
+void
+timeTick(tU32 elapsedMs)
+{
+    if (elapsedMs > 0) tickMs = elapsedMs;
+    timeNowCycles();
+}
+
+/*!
+ *  @brief    A function for reading the raw 32-bit
+ *            cycle counter, intended for measuring short
+ *            intervals (up to ~70 s) with unsigned
+ *            subtraction.
+ *  @returns  current value of the cycle counter
+ */
+tU32
+timeCycles(void)
+{
+    return T1TC;
+}
+
+/*!
+ *  @brief    A function for reading the 64-bit number of
+ *            peripheral clock cycles since timeInit.
+ *  @returns  cycles since timeInit
+ */
+tU64
+timeNowCycles(void)
+{
+    volatile tSR localSR;
+    tU32 low;
+    tU32 high;
+
+    m_os_dis_int();
+    low = T1TC;
+    if (low < lastCycles) cyclesHigh++;
+    lastCycles = low;
+    high = cyclesHigh;
+    m_os_ena_int();
+
+    return ((tU64)high << 32) | low;
+}
+
+/*!
+ *  @brief    A function for reading the time since
+ *            timeInit in milliseconds.
+ *  @returns  milliseconds since timeInit,
+ *            wraps after ~49 days
+ */
+tU32
+timeNowMs(void)
+{
+    return (tU32)(timeNowCycles() / CYCLES_PER_MS);
+}
+
+/*!
+ *  @brief    A function for reading the time since
+ *            timeInit in microseconds.
+ *  @returns  microseconds since timeInit,
+ *            wraps after ~71 minutes
+ */
+tU32
+timeNowUs(void)
+{
+    return (tU32)(timeNowCycles() * 1000 / CYCLES_PER_MS);
+}
+
+/*!
+ *  @brief    A function for converting an interval
+ *            measured with timeCycles to microseconds.
+ *  @param cycles
+ *            Number of cycles.
+ *  @returns  the interval in microseconds
+ */
+tU32
+timeCyclesToUs(tU32 cycles)
+{
+    return (tU32)((tU64)cycles * 1000 / CYCLES_PER_MS);
+}
+
+/*!
+ *  @brief    A function for reading the length of
+ *            the OS tick, as last reported to timeTick.
+ *  @returns  milliseconds per tick
+ */
+tU32
+timeTickMs(void)
+{
+    return tickMs;
+}
+
+/*!
+ *  @brief    A procedure for sleeping until an absolute
+ *            deadline. Periodic loops advancing the
+ *            deadline by their period do not drift, as
+ *            the time spent working and preempted is
+ *            not added to the period. The process wakes
+ *            on the first OS tick past the deadline.
+ *  @param deadlineMs
+ *            Absolute time in milliseconds (see timeNowMs).
+ */
+void
+timeSleepUntil(tU32 deadlineMs)
+{
+    tS32 remaining;
+
+    while ((remaining = (tS32)(deadlineMs - timeNowMs())) > 0)
+    {
+        tU32 ticks = (tU32)remaining / tickMs;
+        osSleep(ticks > 0 ? ticks : 1);
+    }
+}
+
+/*!
+ *  @brief    A procedure for sleeping for a given
+ *            number of milliseconds.
+ *  @param delayMs
+ *            Delay in milliseconds.
+ */
+void
+timeSleepMs(tU32 delayMs)
+{
+    timeSleepUntil(timeNowMs() + delayMs);
+}
@@ -0,0 +1,32 @@
+/******************************************************************************
+ *
+ * Copyright:
+ *    Byczki(TM)
+ *
+ * File:
+ *    systime.h
+ *
+ * Description:
+ *    Expose the millisecond/microsecond time base built on a free-running
+ *    hardware timer (timer #1).
+ *
+ *****************************************************************************/
+#ifndef _SYSTIME_H_
+#define _SYSTIME_H_
+
+#include <general.h>
+
+typedef unsigned long long tU64;
+
+void timeInit(void);
+void timeTick(tU32 elapsedMs);
+tU32 timeCycles(void);
+tU64 timeNowCycles(void);
+tU32 timeNowMs(void);
+tU32 timeNowUs(void);
+tU32 timeCyclesToUs(tU32 cycles);
+tU32 timeTickMs(void);
+void timeSleepUntil(tU32 deadlineMs);
+void timeSleepMs(tU32 delayMs);
+
+#endif
@@ -0,0 +1,276 @@
+/******************************************************************************
+ *
+ * Copyright:
+ *    Byczki(TM)
+ *
+ * File:
+ *    tilemap.c
+ *
+ * Description:
+ *    Implement the tile-based background renderer. The playfield is
+ *    a map of 8x8 tiles indexed into a tileset kept in flash. Moving
+ *    objects mark the tiles they uncover as dirty and only those
+ *    tiles are streamed to the LCD on the next flush.
+ *
+ *****************************************************************************/
+
+#include "pre_emptive_os/api/osapi.h"
+#include "./lcd.h"
+#include "./tilemap.h"
+
+#if TILEMAP_COLS > 16
+#error The dirty bit array holds at most 16 tiles per row
+#endif
+
+#define ALL_COLS_DIRTY (tU16)((1ul << TILEMAP_COLS) - 1)
+
+static const tU8 *tiles;
+static tU8 tileMap[TILEMAP_ROWS][TILEMAP_COLS];
+static tU16 dirtyRows[TILEMAP_ROWS];
+
+/*!
+ *  @brief    A function for converting a rectangle given
+ *            in pixels to the range of tiles it touches,
+ *            clipped to the map.
+ *  @param x
+ *            Left edge of the rectangle.
+ *  @param y
+ *            Top edge of the rectangle.
+ *  @param xLen
+ *            Width of the rectangle.
+ *  @param yLen
+ *            Height of the rectangle.
+ *  @param cols
+ *            Returns a bit mask of the touched tile columns.
+ *  @param firstRow
+ *            Returns the first touched tile row.
+ *  @param lastRow
+ *            Returns the last touched tile row.
+ *  @returns  true if the rectangle touches the map,
+ *            false if it lies completely outside
+ */
+static tBool
+toTiles(tS16 x, tS16 y, tS16 xLen, tS16 yLen,
+        tU16 *cols, tU8 *firstRow, tU8 *lastRow)
+{
+    tS16 right = x + xLen - 1;
+    tS16 bottom = y + yLen - 1;
+    tU8 firstCol;
+    tU8 lastCol;
+
+    if (xLen <= 0 || yLen <= 0) return FALSE;
+    if (right < 0 || bottom < 0 || x >= LCD_WIDTH || y >= LCD_HEIGHT) return FALSE;
+
+    if (x < 0) x = 0;
+    if (y < 0) y = 0;
+    if (right >= LCD_WIDTH) right = LCD_WIDTH - 1;
+    if (bottom >= LCD_HEIGHT) bottom = LCD_HEIGHT - 1;
+
+    firstCol = x / TILE_SIZE;
+    lastCol = right / TILE_SIZE;
+    *cols = (tU16)(((1ul << (lastCol + 1)) - 1) & ~((1ul << firstCol) - 1));
+    *firstRow = y / TILE_SIZE;
+    *lastRow = bottom / TILE_SIZE;
+    return TRUE;
+}
+
+/*!
+ *  @brief    A procedure for streaming a horizontal run
+ *            of tiles in a single window write.
+ *  @param row
+ *            Tile row of the run.
+ *  @param firstCol
+ *            First tile column of the run.
+ *  @param count
+ *            Number of tiles in the run.
+ */
+static void
+drawRun(tU8 row, tU8 firstCol, tU8 count)
+{
+    tU8 line;
+    tU8 col;
+    tU8 i;
+
+    lcdStartWrite(firstCol * TILE_SIZE, row * TILE_SIZE, count * TILE_SIZE, TILE_SIZE);
+    for (line = 0; line < TILE_SIZE; line++)
+    {
+        for (col = firstCol; col < firstCol + count; col++)
+        {
+            const tU8 *pixels = &tiles[tileMap[row][col] * TILE_BYTES + line * TILE_SIZE];
+            for (i = 0; i < TILE_SIZE; i++)
+                lcdWrdata(pixels[i]);
+        }
+    }
+    lcdEndWrite();
+}
+
+/*!
+ *  @brief    A procedure for initializing the map.
+ *            All tiles are set to the first tile of
+ *            the set and marked as dirty.
+ *  @param tileSet
+ *            A pointer to the flash-resident tileset,
+ *            TILE_BYTES bytes per tile in RRRGGGBB format.
+ */
+void
+tileMapInit(const tU8 *tileSet)
+{
+    tU8 row;
+    tU8 col;
+
+    tiles = tileSet;
+    for (row = 0; row < TILEMAP_ROWS; row++)
+    {
+        for (col = 0; col < TILEMAP_COLS; col++)
+            tileMap[row][col] = 0;
+        dirtyRows[row] = ALL_COLS_DIRTY;
+    }
+}
+
+/*!
+ *  @brief    A procedure for changing a single tile
+ *            of the map. The tile is marked as dirty
+ *            if it has changed.
+ *  @param col
+ *            Tile column.
+ *  @param row
+ *            Tile row.
+ *  @param tile
+ *            Index of the tile in the tileset.
+ */
+void
+tileMapSet(tU8 col, tU8 row, tU8 tile)
+{
+    if (col >= TILEMAP_COLS || row >= TILEMAP_ROWS) return;
+    if (tileMap[row][col] == tile) return;
+
+    tileMap[row][col] = tile;
+    dirtyRows[row] |= (tU16)(1u << col);
+}
+
+/*!
+ *  @brief    A procedure for marking all the tiles
+ *            touched by a rectangle as dirty, e.g. the
+ *            area uncovered by a moving object.
+ *  @param x
+ *            Left edge of the rectangle in pixels.
+ *  @param y
+ *            Top edge of the rectangle in pixels.
+ *  @param xLen
+ *            Width of the rectangle.
+ *  @param yLen
+ *            Height of the rectangle.
+ */
+void
+tileMapMarkDirty(tS16 x, tS16 y, tS16 xLen, tS16 yLen)
+{
+    tU16 cols;
+    tU8 firstRow;
+    tU8 lastRow;
+    tU8 row;
+
+    if (toTiles(x, y, xLen, yLen, &cols, &firstRow, &lastRow) == FALSE) return;
+
+    for (row = firstRow; row <= lastRow; row++)
+        dirtyRows[row] |= cols;
+}
+
+/*!
+ *  @brief    A function checking if a rectangle touches
+ *            any dirty tile, i.e. if it will be painted
+ *            over by the next flush.
+ *  @param x
+ *            Left edge of the rectangle in pixels.
+ *  @param y
+ *            Top edge of the rectangle in pixels.
+ *  @param xLen
+ *            Width of the rectangle.
+ *  @param yLen
+ *            Height of the rectangle.
+ *  @returns  true if at least one touched tile is dirty
+ */
+tBool
+tileMapIsDirty(tS16 x, tS16 y, tS16 xLen, tS16 yLen)
+{
+    tU16 cols;
+    tU8 firstRow;
+    tU8 lastRow;
+    tU8 row;
+
+    if (toTiles(x, y, xLen, yLen, &cols, &firstRow, &lastRow) == FALSE) return FALSE;
+
+    for (row = firstRow; row <= lastRow; row++)
+    {
+        if (dirtyRows[row] & cols) return TRUE;
+    }
+    return FALSE;
+}
+
+/*!
+ *  @brief    A procedure for streaming all dirty tiles
+ *            to the LCD. Neighbouring dirty tiles in a row
+ *            are merged into a single window write.
+ */
+void
+tileMapFlush(void)
+{
+    tU8 row;
+
+    for (row = 0; row < TILEMAP_ROWS; row++)
+    {
+        tU16 dirty = dirtyRows[row];
+        tU8 col = 0;
+
+        if (dirty == 0) continue;
+        dirtyRows[row] = 0;
+
+        while (dirty != 0)
+        {
+            tU8 first;
+
+            while ((dirty & 1) == 0)
+            {
+                dirty >>= 1;
+                col++;
+            }
+            first = col;
+            while (dirty & 1)
+            {
+                dirty >>= 1;
+                col++;
+            }
+            drawRun(row, first, col - first);
+        }
+    }
+}
+
+/*!
+ *  @brief    A procedure for redrawing the whole
+ *            background, row by row.
+ */
+void
+tileMapDrawAll(void)
+{
+    tU8 row;
+
+    for (row = 0; row < TILEMAP_ROWS; row++)
+        dirtyRows[row] = ALL_COLS_DIRTY;
+    tileMapFlush();
+}
+
+/*!
+ *  @brief    A function for reading a single background
+ *            pixel, used to composite sprites over the map.
+ *  @param x
+ *            Screen x-coordinate of the pixel.
+ *  @param y
+ *            Screen y-coordinate of the pixel.
+ *  @returns  colour of the background pixel
+ */
+tU8
+tileMapPixel(tU8 x, tU8 y)
+{
+    if (x >= LCD_WIDTH || y >= LCD_HEIGHT) return BLACK;
+    return tiles[tileMap[y / TILE_SIZE][x / TILE_SIZE] * TILE_BYTES +
+                 (y % TILE_SIZE) * TILE_SIZE + (x % TILE_SIZE)];
+}
@@ -0,0 +1,32 @@
+/******************************************************************************
+ *
+ * Copyright:
+ *    Byczki(TM)
+ *
+ * File:
+ *    tilemap.h
+ *
+ * Description:
+ *    Expose public functions and defines of the tile-based background.
+ *
+ *****************************************************************************/
+#ifndef _TILEMAP_H_
+#define _TILEMAP_H_
+
+#include <general.h>
+#include "./lcd.h"
+
+#define TILE_SIZE 8
+#define TILE_BYTES (TILE_SIZE * TILE_SIZE)
+#define TILEMAP_COLS (LCD_WIDTH / TILE_SIZE)
+#define TILEMAP_ROWS (LCD_HEIGHT / TILE_SIZE)
+
+void tileMapInit(const tU8 *tileSet);
+void tileMapSet(tU8 col, tU8 row, tU8 tile);
+void tileMapMarkDirty(tS16 x, tS16 y, tS16 xLen, tS16 yLen);
+tBool tileMapIsDirty(tS16 x, tS16 y, tS16 xLen, tS16 yLen);
+void tileMapFlush(void);
+void tileMapDrawAll(void);
+tU8 tileMapPixel(tU8 x, tU8 y);
+
+#endif
@@ -0,0 +1,231 @@
+/******************************************************************************
+ *
+ * Copyright:
+ *    Byczki(TM)
+ *
+ * File:
+ *    wave.c
+ *
+ * Description:
+ *    Implement the obstacle wave scheduler. Waves are designed in
+ *    const tables kept in flash: every step of a pattern is a row
+ *    of obstacles with a gap left for the ball. Designed waves are
+ *    blended with waves of single random blocks, more of them
+ *    designed and harder ones allowed as the wave level grows. Each
+ *    wave is played mirrored or shifted at random, the gap never
+ *    leaves the screen, so every row stays passable.
+ *
+ *****************************************************************************/
+
+#include "pre_emptive_os/api/osapi.h"
+#include "./lcd.h"
+#include "./prng.h"
+#include "./wave.h"
+
+#define RANDOM_PATTERN 0xff
+#define RANDOM_WAVE_ROWS 3
+
+#define WAVE_SEPARATION 36
+#define WAVE_MAX_SHIFT 8
+
+/* chance of a designed wave in percent: base + step * wave level */
+#define DESIGNED_CHANCE_BASE 25
+#define DESIGNED_CHANCE_STEP 25
+
+#define MIN_SPACING 16
+#define MIN_HEIGHT 1
+#define MAX_HEIGHT 5
+
+#define RANDOM_SPACING 30
+#define RANDOM_MIN_WIDTH 20
+#define RANDOM_MAX_WIDTH 60
+
+/*
+ * One row of a pattern: a gap of gapWidth pixels starting at gapX,
+ * the rest of the row is filled with obstacles.
+ */
+typedef struct WaveStep
+{
+    tU8 gapX;
+    tU8 gapWidth;
+    tU8 spacing;
+} WaveStep;
+
+typedef struct WavePattern
+{
+    const WaveStep *steps;
+    tU8 numSteps;
+    tU8 difficulty;
+} WavePattern;
+
+static const WaveStep gapSteps[] =
+{
+    { 48, 32, 40 }
+};
+
+static const WaveStep corridorSteps[] =
+{
+    { 40, 28, 20 }, { 40, 28, 20 }, { 40, 28, 20 }, { 40, 28, 20 }
+};
+
+static const WaveStep funnelSteps[] =
+{
+    { 24, 80, 24 }, { 36, 56, 24 }, { 48, 32, 24 }
+};
+
+static const WaveStep zigZagSteps[] =
+{
+    { 16, 28, 32 }, { 84, 28, 32 }, { 16, 28, 32 }, { 84, 28, 32 }
+};
+
+static const WaveStep slalomSteps[] =
+{
+    { 8, 24, 28 }, { 56, 24, 28 }, { 96, 24, 28 }, { 56, 24, 28 }, { 8, 24, 28 }
+};
+
+#define STEPS(steps) steps, sizeof(steps) / sizeof(steps[0])
+
+/* sorted by difficulty */
+static const WavePattern patterns[] =
+{
+    { STEPS(gapSteps), 0 },
+    { STEPS(corridorSteps), 1 },
+    { STEPS(funnelSteps), 1 },
+    { STEPS(zigZagSteps), 2 },
+    { STEPS(slalomSteps), 3 }
+};
+
+#define NUM_PATTERNS (sizeof(patterns) / sizeof(patterns[0]))
+
+/*!
+ *  @brief    A procedure for choosing the next wave
+ *            and the variant it is played in.
+ *  @param wave
+ *            A pointer to the scheduler state.
+ *  @param level
+ *            Current difficulty.
+ */
+static void
+startWave(WaveState *wave, const DifficultyLevel *level)
+{
+    tU8 difficulty = level->waveLevel;
+    tU8 available = 0;
+
+    if (difficulty > WAVE_MAX_DIFFICULTY) difficulty = WAVE_MAX_DIFFICULTY;
+
+    while (available < NUM_PATTERNS && patterns[available].difficulty <= difficulty)
+        available++;
+
+    if (prngRange(0, 99) < DESIGNED_CHANCE_BASE + DESIGNED_CHANCE_STEP * difficulty)
+        wave->pattern = (tU8)prngRange(0, available - 1);
+    else
+        wave->pattern = RANDOM_PATTERN;
+
+    wave->step = 0;
+    wave->mirror = (tU8)(prngNext() & 1);
+    wave->shift = (tS8)prngRange(0, 2 * WAVE_MAX_SHIFT) - WAVE_MAX_SHIFT;
+    wave->speed = (tU8)prngRange(level->minSpeed, level->maxSpeed);
+    wave->height = (tU8)prngRange(MIN_HEIGHT, MAX_HEIGHT);
+}
+
+/*!
+ *  @brief    A procedure for turning a pattern step into
+ *            a row of obstacles around its gap, applying the
+ *            variant of the current wave.
+ *  @param wave
+ *            A pointer to the scheduler state.
+ *  @param step
+ *            A pointer to the pattern step.
+ *  @param row
+ *            A pointer to the row to fill.
+ */
+static void
+buildGapRow(const WaveState *wave, const WaveStep *step, WaveRow *row)
+{
+    tS16 gapX = step->gapX + wave->shift;
+    tS16 gapEnd;
+
+    if (wave->mirror) gapX = LCD_WIDTH - step->gapWidth - gapX;
+    if (gapX < 0) gapX = 0;
+    if (gapX > LCD_WIDTH - step->gapWidth) gapX = LCD_WIDTH - step->gapWidth;
+    gapEnd = gapX + step->gapWidth;
+
+    row->numBlocks = 0;
+    if (gapX > 0)
+    {
+        row->blocks[row->numBlocks].x = 0;
+        row->blocks[row->numBlocks].width = (tU8)gapX;
+        row->numBlocks++;
+    }
+    if (gapEnd < LCD_WIDTH)
+    {
+        row->blocks[row->numBlocks].x = (tU8)gapEnd;
+        row->blocks[row->numBlocks].width = (tU8)(LCD_WIDTH - gapEnd);
+        row->numBlocks++;
+    }
+    row->spacing = step->spacing;
+}
+
+/*!
+ *  @brief    A procedure for building a row of a single
+ *            random block.
+ *  @param row
+ *            A pointer to the row to fill.
+ */
+static void
+buildRandomRow(WaveRow *row)
+{
+    tU8 width = (tU8)prngRange(RANDOM_MIN_WIDTH, RANDOM_MAX_WIDTH);
+
+    row->blocks[0].x = (tU8)prngRange(0, LCD_WIDTH - width);
+    row->blocks[0].width = width;
+    row->numBlocks = 1;
+    row->spacing = RANDOM_SPACING;
+}
+
+/*!
+ *  @brief    A procedure for resetting the scheduler,
+ *            the next row starts a new wave.
+ *  @param wave
+ *            A pointer to the scheduler state.
+ */
+void
+waveReset(WaveState *wave)
+{
+    wave->pattern = RANDOM_PATTERN;
+    wave->step = RANDOM_WAVE_ROWS;
+}
+
+/*!
+ *  @brief    A procedure for reading the next row of
+ *            obstacles to spawn. A new wave is chosen when
+ *            the current one is over.
+ *  @param wave
+ *            A pointer to the scheduler state.
+ *  @param level
+ *            Current difficulty, its spacing applies
+ *            to the row.
+ *  @param row
+ *            A pointer to the row to fill.
+ */
+void
+waveNextRow(WaveState *wave, const DifficultyLevel *level, WaveRow *row)
+{
+    tU8 numSteps = wave->pattern == RANDOM_PATTERN ?
+                   RANDOM_WAVE_ROWS : patterns[wave->pattern].numSteps;
+    tU16 spacing;
+
+    if (wave->step >= numSteps) startWave(wave, level);
+
+    if (wave->pattern == RANDOM_PATTERN) buildRandomRow(row);
+    else buildGapRow(wave, &patterns[wave->pattern].steps[wave->step], row);
+
+    if (wave->step == 0 && row->spacing < WAVE_SEPARATION) row->spacing = WAVE_SEPARATION;
+    spacing = (tU16)row->spacing * level->spacingPercent / 100;
+    if (spacing < MIN_SPACING) spacing = MIN_SPACING;
+    if (spacing > LCD_HEIGHT) spacing = LCD_HEIGHT;
+    row->spacing = (tU8)spacing;
+    row->height = wave->height;
+    row->speed = wave->speed;
+    wave->step++;
+}
@@ -0,0 +1,61 @@
+/******************************************************************************
+ *
+ * Copyright:
+ *    Byczki(TM)
+ *
+ * File:
+ *    wave.h
+ *
+ * Description:
+ *    Expose the obstacle wave scheduler.
+ *
+ *****************************************************************************/
+#ifndef _WAVE_H_
+#define _WAVE_H_
+
+#include <general.h>
+#include "./difficulty.h"
+
+#define WAVE_MAX_DIFFICULTY 3
+#define WAVE_MAX_BLOCKS 2
+
+/*
+ * A single obstacle of a row.
+ */
+typedef struct WaveBlock
+{
+    tU8 x;
+    tU8 width;
+} WaveBlock;
+
+/*
+ * A row of obstacles spawned together, once the previous row has
+ * moved spacing pixels down from the top of the screen.
+ */
+typedef struct WaveRow
+{
+    WaveBlock blocks[WAVE_MAX_BLOCKS];
+    tU8 numBlocks;
+    tU8 height;
+    tU8 speed;
+    tU8 spacing;
+} WaveRow;
+
+/*
+ * Position of the scheduler in the current wave, together with the
+ * random variant the wave is played in.
+ */
+typedef struct WaveState
+{
+    tU8 pattern;
+    tU8 step;
+    tU8 mirror;
+    tS8 shift;
+    tU8 speed;
+    tU8 height;
+} WaveState;
+
+void waveReset(WaveState *wave);
+void waveNextRow(WaveState *wave, const DifficultyLevel *level, WaveRow *row);
+
+#endif